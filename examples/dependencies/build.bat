@@ -12,12 +12,14 @@ if NOT "%1" == "" (
 	set MODE=%1
 )
 
-set DEPENDENCIES=vrpn
+set DEPENDENCIES=vrpn native
 (for %%d in (%DEPENDENCIES%) do (
 	pushd buildfiles\%%d
 	echo =====================================================================
 	echo Downloading, building and installing %%d...
-	fetch.bat
+	if exist fetch.bat (
+		fetch.bat
+	)
 	if exist build.bat (
 		build.bat %MODE%
 	)
@@ -3,12 +3,14 @@
 # Select release or debug mode
 MODE="$(echo $1 | tr '[:upper:]' '[:lower:]')"
 
-DEPENDENCIES="vrpn"
+DEPENDENCIES="vrpn native"
 for DEP in $DEPENDENCIES; do
 	pushd buildfiles/$DEP > /dev/null
 	echo "====================================================================="
 	echo "Downloading, building and installing $DEP..."
-	./fetch.sh
+	if [[ -f "fetch.sh" ]]; then
+		./fetch.sh
+	fi
 	if [[ -f "build.sh" ]]; then
 		./build.sh
 	fi
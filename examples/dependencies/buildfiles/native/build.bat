@@ -0,0 +1,72 @@
+@echo off & SETLOCAL ENABLEEXTENSIONS ENABLEDELAYEDEXPANSION
+
+:: Make sure we have the environment variables necessary to build
+if NOT "%VSCMD_ARG_TGT_ARCH%" == "x64" (
+	echo Please use the x64 Native Tools Command Prompt for vcvars64 environment!
+	exit /B
+)
+
+:: Native python modules complementing the VRPN python bindings, source is part of the examples
+set SRC_PATH=..\..\..\python\native
+if not exist "%SRC_PATH%" (
+	echo %SRC_PATH% does not exist!
+	exit /B
+)
+
+:: Select release or debug mode
+set MODE=%1
+if "%MODE%"=="" (
+	set MODE=release
+)
+
+:: Python version needs to match the one used by Blender
+:: Set BLENDER_PYTHON to a python executable of that version, if the default one does not match
+set PYTHON_ARGS=
+if NOT "%BLENDER_PYTHON%"=="" (
+	set PYTHON_ARGS=-DPython3_EXECUTABLE=%BLENDER_PYTHON%
+)
+
+if not exist win\build\%MODE% md win\build\%MODE%
+if not exist win\install\%MODE% md win\install\%MODE%
+
+echo -----------------------------------------
+echo Building native modules
+echo -----------------------------------------
+
+:: Needs to match the runtime library VRPN was built with
+if "%MODE%"=="debug" (
+	set CRT=MultiThreadedDebug
+) else (
+	set CRT=MultiThreaded
+)
+
+pushd win\build\%MODE%
+cmake -DCMAKE_MSVC_RUNTIME_LIBRARY=%CRT% -DCMAKE_POLICY_DEFAULT_CMP0091=NEW %PYTHON_ARGS% ^
+	-DCMAKE_BUILD_TYPE=%MODE% -G "NMake Makefiles" ..\..\..\%SRC_PATH%
+nmake vrpn_recorder vrpn_receiver
+cmake -DCMAKE_INSTALL_PREFIX=..\..\install\%MODE% -P cmake_install.cmake
+popd
+
+echo -----------------------------------------
+echo Build completed
+echo -----------------------------------------
+
+:: Try to verify output
+for %%m in (vrpn_recorder vrpn_receiver) do (
+	if not exist win\install\%MODE%\%%m*.pyd (
+		echo Build failed - win\install\%MODE%\%%m*.pyd does not exist!
+		exit /B
+	)
+)
+
+:: Copy resulting files to project directory
+if "%CD:~-31%" neq "\dependencies\buildfiles\native" (
+	echo Not in dependencies\buildfiles\native subfolder, can't automatically install files into project folder!
+	exit /B
+)
+
+echo Installing dependency files...
+if not exist ..\..\..\python\lib md ..\..\..\python\lib
+copy win\install\%MODE%\*.pyd ..\..\..\python\lib
+
+echo Now you can call clean.bat if everything succeeded.
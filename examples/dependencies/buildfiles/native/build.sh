@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+
+# Native python modules complementing the VRPN python bindings, source is part of the examples
+SRC_PATH=../../../python/native
+if [[ ! -d "$SRC_PATH" ]]; then
+	echo "$SRC_PATH does not exist!"
+	exit 1
+fi
+
+# Python version needs to match the one used by Blender
+# Set BLENDER_PYTHON to a python executable of that version, if the default one does not match
+PYTHON_ARGS=""
+if [[ ! -z "$BLENDER_PYTHON" ]]; then
+	PYTHON_ARGS="-DPython3_EXECUTABLE=$BLENDER_PYTHON"
+fi
+
+# Create temporary directories
+mkdir -p linux/build
+mkdir -p linux/install
+
+echo -----------------------------------------
+echo Building native modules
+echo -----------------------------------------
+
+pushd linux/build
+cmake ../../$SRC_PATH -DCMAKE_BUILD_TYPE=Release $PYTHON_ARGS
+make -j4 vrpn_recorder vrpn_receiver
+cmake -DCMAKE_INSTALL_PREFIX=../install -P cmake_install.cmake
+popd
+
+echo -----------------------------------------
+echo Build completed
+echo -----------------------------------------
+
+# Try to verify output
+for MODULE in vrpn_recorder vrpn_receiver; do
+	if ! ls linux/install/$MODULE*.so > /dev/null 2>&1; then
+		echo "Build failed - linux/install/$MODULE*.so does not exist!"
+		exit 3
+	fi
+done
+
+# Copy resulting files to project directory
+if [[ "${PWD:(-31)}" != "/dependencies/buildfiles/native" ]]; then
+	echo "Not in dependencies/buildfiles/native subfolder, can't automatically install files into project folder!"
+	exit 4
+fi
+
+echo "Installing dependency files..."
+
+mkdir -p ../../../python/lib
+cp linux/install/*.so ../../../python/lib
+
+echo "Now you can call clean.sh if everything succeeded."
@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+MODE="$(echo $1 | tr '[:upper:]' '[:lower:]')"
+if [[ $MODE == build ]]; then
+	echo Cleaning linux builds
+	rm -r linux
+else
+	echo Cleaning all builds
+	rm -r win
+	rm -r linux
+fi
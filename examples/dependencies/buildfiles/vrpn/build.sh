@@ -20,7 +20,7 @@ rm $SRC_PATH/ParseVersion.cmake
 touch $SRC_PATH/ParseVersion.cmake
 
 pushd linux/build
-cmake ../../$SRC_PATH -DVRPN_USE_STD_CHRONO=ON -DVRPN_USE_GPM_MOUSE=OFF -DVRPN_BUILD_PYTHON_HANDCODED_3X=ON
+cmake ../../$SRC_PATH -DVRPN_USE_STD_CHRONO=ON -DVRPN_USE_GPM_MOUSE=OFF -DVRPN_BUILD_PYTHON_HANDCODED_3X=ON -DCMAKE_POSITION_INDEPENDENT_CODE=ON
 make -j4 quat vrpn vrpn-python
 cmake -DCMAKE_INSTALL_COMPONENT=clientsdk -DCMAKE_INSTALL_PREFIX=../cpp -P cmake_install.cmake
 cmake -DCMAKE_INSTALL_COMPONENT=python -DCMAKE_INSTALL_PREFIX=../python -P cmake_install.cmake
@@ -6,7 +6,7 @@ if NOT "%1" == "" (
 	set MODE=%1 
 )
 
-set DEPENDENCIES=vrpn
+set DEPENDENCIES=vrpn native
 (for %%d in (%DEPENDENCIES%) do (
 	pushd buildfiles\%%d
 	if exist clean.bat (
@@ -5,7 +5,7 @@ if [[ ! -z $1 ]]; then
 	MODE=$1
 fi
 
-DEPENDENCIES="vrpn"
+DEPENDENCIES="vrpn native"
 for DEP in $DEPENDENCIES; do
 	pushd buildfiles/$DEP
 	if [[ -f "clean.sh" ]]; then
@@ -0,0 +1,127 @@
+# Reads poses republished by the AsterTrack viewer/headless client into shared memory
+# Start the client with --shm /astertrack-poses (or "shared_memory" in its config), then run this script
+# Layout and read protocol are documented in shared/pose_shm.h - this mirrors it for python without any dependencies
+# Linux only, POSIX shared memory segments are exposed in /dev/shm
+
+import mmap
+import os
+import struct
+import sys
+import time
+
+SHM_MAGIC = 0x50485341
+SHM_VERSION = 1
+SHM_DEFAULT_NAME = "/astertrack-poses"
+
+HEADER = struct.Struct("<14I q")
+EVENT_HEAD = struct.Struct("<Q") # At offset 64
+POSE = struct.Struct("<I i q q 3f 4f")
+TRACKER = struct.Struct("<4I 112s")
+EVENT = struct.Struct("<Q I i q q 3f 4f I")
+SEQ32 = struct.Struct("<I")
+SEQ64 = struct.Struct("<Q")
+
+class Pose:
+	__slots__ = ("tracker", "sensor", "timestamp_us", "received_us", "position", "rotation")
+	def __init__(self, tracker, sensor, timestamp_us, received_us, position, rotation):
+		self.tracker = tracker
+		self.sensor = sensor
+		self.timestamp_us = timestamp_us
+		self.received_us = received_us
+		self.position = position # x, y, z
+		self.rotation = rotation # x, y, z, w
+
+	def __repr__(self):
+		return "Pose(tracker=%d, sensor=%d, position=(%.3f, %.3f, %.3f), latency=%.2fms)" % (
+			self.tracker, self.sensor, *self.position, (self.received_us - self.timestamp_us) / 1000)
+
+class PoseReader:
+	def __init__(self, name=SHM_DEFAULT_NAME):
+		path = "/dev/shm/" + name.lstrip("/")
+		with open(path, "rb") as file:
+			self.shm = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+		(magic, version, self.header_size, self.tracker_size, self.pose_size, self.event_size,
+			self.max_trackers, self.max_sensors, self.event_count, self.tracker_offset, self.event_offset,
+			self.writer_pid, _, _, self.start_us) = HEADER.unpack_from(self.shm, 0)
+		if magic != SHM_MAGIC:
+			raise RuntimeError("Shared memory '%s' is not (yet) an AsterTrack pose segment" % name)
+		if version != SHM_VERSION:
+			raise RuntimeError("Shared memory '%s' has unsupported version %d" % (name, version))
+		# Only read events published from now on
+		self.cursor = self.event_head()
+
+	def close(self):
+		self.shm.close()
+
+	def is_open(self):
+		return HEADER.unpack_from(self.shm, 0)[12] != 0
+
+	def event_head(self):
+		return EVENT_HEAD.unpack_from(self.shm, 64)[0]
+
+	def trackers(self):
+		"""Returns dict of slot -> (id, path) of all active trackers"""
+		trackers = {}
+		for slot in range(self.max_trackers):
+			offset = self.tracker_offset + slot * self.tracker_size
+			while True:
+				seq0, id, active, _, path = TRACKER.unpack_from(self.shm, offset)
+				if seq0 & 1: continue
+				if SEQ32.unpack_from(self.shm, offset)[0] == seq0: break
+			if active:
+				trackers[slot] = (id, path.split(b"\0", 1)[0].decode())
+		return trackers
+
+	def latest(self, slot, sensor=0):
+		"""Returns latest pose of sensor of tracker in slot, or None if it has not received any"""
+		tracker = self.tracker_offset + slot * self.tracker_size
+		offset = tracker + TRACKER.size + (self.pose_size * sensor)
+		while True:
+			slot_seq0, id = TRACKER.unpack_from(self.shm, tracker)[0:2]
+			if slot_seq0 & 1: continue
+			while True:
+				seq0, sensor, timestamp_us, received_us, *values = POSE.unpack_from(self.shm, offset)
+				if seq0 & 1: continue
+				if SEQ32.unpack_from(self.shm, offset)[0] == seq0: break
+			# Retry if the slot was reassigned meanwhile, so the pose belongs to tracker id
+			if SEQ32.unpack_from(self.shm, tracker)[0] == slot_seq0: break
+		if seq0 == 0 or timestamp_us == 0: return None # Never written, or cleared with its previous tracker
+		return Pose(id, sensor, timestamp_us, received_us, tuple(values[0:3]), tuple(values[3:7]))
+
+	def events(self):
+		"""Returns all poses published since the last call, in order of arrival, and the number of poses missed"""
+		head = self.event_head()
+		missed = 0
+		if head - self.cursor > self.event_count:
+			# Fell behind more than the ring holds
+			missed = head - self.event_count - self.cursor
+			self.cursor = head - self.event_count
+		poses = []
+		while self.cursor < head:
+			offset = self.event_offset + (self.cursor % self.event_count) * self.event_size
+			seq0, id, sensor, timestamp_us, received_us, *values = EVENT.unpack_from(self.shm, offset)
+			if seq0 < self.cursor+1:
+				# Still being written (0), or head already advanced but the slot still holds an older event
+				break # Continue here next call
+			if seq0 > self.cursor+1 or SEQ64.unpack_from(self.shm, offset)[0] != seq0:
+				# Overwritten before or while reading
+				missed += 1
+			else:
+				poses.append(Pose(id, sensor, timestamp_us, received_us, tuple(values[0:3]), tuple(values[3:7])))
+			self.cursor += 1
+		return poses, missed
+
+if __name__ == "__main__":
+	reader = PoseReader(sys.argv[1] if len(sys.argv) > 1 else SHM_DEFAULT_NAME)
+	print("Reading poses of client with pid %d" % reader.writer_pid)
+	for slot, (id, path) in reader.trackers().items():
+		print("Tracker %d: %s" % (id, path))
+	try:
+		while reader.is_open():
+			poses, missed = reader.events()
+			if poses:
+				print("%d poses (%d missed), latest %s" % (len(poses), missed, poses[-1]))
+			time.sleep(0.5)
+	except KeyboardInterrupt:
+		pass
+	reader.close()
@@ -15,8 +15,6 @@ import threading
 import time
 from datetime import datetime, timezone, timedelta
 from collections import deque, defaultdict
-import array
-import bisect
 
 import sys
 
@@ -25,11 +23,19 @@ vrpnLibPath = 'lib'
 if vrpnLibPath not in sys.path:
 	sys.path.append(vrpnLibPath)
 import vrpn
+# Optional native recorder (see native/), receives and records off the GIL
+try:
+	import vrpn_recorder
+except ImportError:
+	vrpn_recorder = None
+import numpy as np
 
 class VRPNTrackerInfo:
 	def __init__(self):
 		self.trackerSetup = None
 		self.trackerVRPN = None
+		self.nativeIndex = None
+		self.lastTime = None
 		self.trackingQueue = deque()
 		self.hasReceived = False
 		self.hasRecorded = False
@@ -45,6 +51,12 @@ recording_startFrame = None
 recording_startTime = None
 recording_database = None
 
+# Native recorder, kept across streaming sessions until a new recording starts
+native_recorder = None
+native_indices = dict()
+native_recording = None # (startTime, startFrame, fps) of last native recording
+native_keyframing = False # Whether to apply recording to keyframes once it ends
+
 class RecordedTracker:
 	def __init__(self, frame, mat):
 		self.frame = frame
@@ -68,8 +80,13 @@ def vrpn_startStreaming(context):
 	global vrpn_streaming
 	global vrpn_trackers
 
+	global native_recorder
+
 	settings = context.scene.VRPNSettings
 
+	if vrpn_recorder and native_recorder is None:
+		native_recorder = vrpn_recorder.Recorder(settings.record_minutes*60*settings.record_rate)
+
 	# Update vrpn_trackers with trackers setup in UI
 	with vrpn_lock:
 		for tracker in settings.trackers:
@@ -80,13 +97,21 @@ def vrpn_startStreaming(context):
 			path = tracker.vrpnPath
 			if not "@" in path:
 				path = path + "@localhost"
-			trk.trackerVRPN = vrpn.receiver.Tracker(path)
-			trk.trackerVRPN.register_change_handler(trk, vrpn_receiveTrackerPos, "position")
-			trk.trackerVRPN.register_change_handler(trk, vrpn_receiveTrackerVel, "velocity")
+			if native_recorder:
+				if not tracker.vrpnPath in native_indices:
+					native_indices[tracker.vrpnPath] = native_recorder.add(path)
+				trk.nativeIndex = native_indices[tracker.vrpnPath]
+			else:
+				trk.trackerVRPN = vrpn.receiver.Tracker(path)
+				trk.trackerVRPN.register_change_handler(trk, vrpn_receiveTrackerPos, "position")
+				trk.trackerVRPN.register_change_handler(trk, vrpn_receiveTrackerVel, "velocity")
 			vrpn_trackers[tracker.vrpnPath] = trk
-		# Start thread if not already running
 		vrpn_streaming = True
-		if vrpn_thread is None:
+		if native_recorder:
+			# Native recorder receives on its own thread
+			native_recorder.start()
+		elif vrpn_thread is None:
+			# Start thread if not already running
 			vrpn_thread = threading.Thread(target=vrpn_CommsThread)
 			vrpn_thread.start()
 
@@ -96,9 +121,13 @@ def vrpn_stopStreaming(context):
 	global vrpn_streaming
 	global vrpn_trackers
 
+	finishRecording(context)
+
 	vrpn_streaming = False
 	if vrpn_thread is not None:
 		vrpn_thread.join()
+	if native_recorder:
+		native_recorder.stop()
 	with vrpn_lock:
 		vrpn_thread = None
 		for name, trk in vrpn_trackers.items():
@@ -138,19 +167,155 @@ def getTrackerTarget(tracker):
 
 	return target
 
+def getLocalOffset(tracker):
+	m_local_pos = Matrix.Translation(tracker.local_pos)
+	m_local_rot = Euler((math.radians(tracker.local_rot[0]),math.radians(tracker.local_rot[1]),math.radians(tracker.local_rot[2]))).to_matrix().to_4x4()
+	m_local_scale = Matrix.Scale(tracker.local_scale[0],4,(1,0,0)) @ Matrix.Scale(tracker.local_scale[1],4,(0,1,0)) @ Matrix.Scale(tracker.local_scale[2],4,(0,0,1))
+	return m_local_pos @ m_local_rot @ m_local_scale
+
 def getTargetTransform(tracker, target, mat):
 	if tracker.origin:
 		origin = bpy.data.objects[tracker.origin]
 		mat = origin.matrix_world @ mat
 	if tracker.use_local_offset:
-		m_local_pos = Matrix.Translation(tracker.local_pos)
-		m_local_rot = Euler((math.radians(tracker.local_rot[0]),math.radians(tracker.local_rot[1]),math.radians(tracker.local_rot[2]))).to_matrix().to_4x4()
-		m_local_scale = Matrix.Scale(tracker.local_scale[0],4,(1,0,0)) @ Matrix.Scale(tracker.local_scale[1],4,(0,1,0)) @ Matrix.Scale(tracker.local_scale[2],4,(0,0,1))
-		mat = mat @ m_local_pos @ m_local_rot @ m_local_scale
+		mat = mat @ getLocalOffset(tracker)
 	if target.bl_rna.name == 'Pose Bone':
 		mat = target.id_data.convert_space(pose_bone=target, matrix=mat, from_space='WORLD', to_space='LOCAL')
 	return mat
 
+def quaternionsToMatrices(quat):
+	# Quaternions as x, y, z, w like VRPN
+	quat = quat / np.linalg.norm(quat, axis=1, keepdims=True)
+	x, y, z, w = quat[:,0], quat[:,1], quat[:,2], quat[:,3]
+	mats = np.empty((len(quat), 3, 3))
+	mats[:,0,0] = 1 - 2*(y*y + z*z)
+	mats[:,0,1] = 2*(x*y - z*w)
+	mats[:,0,2] = 2*(x*z + y*w)
+	mats[:,1,0] = 2*(x*y + z*w)
+	mats[:,1,1] = 1 - 2*(x*x + z*z)
+	mats[:,1,2] = 2*(y*z - x*w)
+	mats[:,2,0] = 2*(x*z - y*w)
+	mats[:,2,1] = 2*(y*z + x*w)
+	mats[:,2,2] = 1 - 2*(x*x + y*y)
+	return mats
+
+def matricesToQuaternions(mats):
+	# Quaternions as w, x, y, z like Blender, ignoring scale like Matrix.to_quaternion
+	mats = mats / np.linalg.norm(mats, axis=1, keepdims=True)
+	m00, m11, m22 = mats[:,0,0], mats[:,1,1], mats[:,2,2]
+	quat = np.empty((len(mats), 4))
+	quat[:,0] = np.sqrt(np.maximum(0, 1 + m00 + m11 + m22)) / 2
+	quat[:,1] = np.copysign(np.sqrt(np.maximum(0, 1 + m00 - m11 - m22)) / 2, mats[:,2,1] - mats[:,1,2])
+	quat[:,2] = np.copysign(np.sqrt(np.maximum(0, 1 - m00 + m11 - m22)) / 2, mats[:,0,2] - mats[:,2,0])
+	quat[:,3] = np.copysign(np.sqrt(np.maximum(0, 1 - m00 - m11 + m22)) / 2, mats[:,1,0] - mats[:,0,1])
+	return quat / np.linalg.norm(quat, axis=1, keepdims=True)
+
+def getTargetTransforms(tracker, target, pos, quat, old_rot):
+	"""Bulk version of getTargetTransform for recorded samples, returns location and rotation arrays for the FCurves"""
+	mats = np.zeros((len(pos), 4, 4))
+	mats[:,:3,:3] = quaternionsToMatrices(quat)
+	mats[:,:3,3] = pos
+	mats[:,3,3] = 1
+	if tracker.origin:
+		origin = bpy.data.objects[tracker.origin]
+		mats = np.array(origin.matrix_world) @ mats
+	if tracker.use_local_offset:
+		mats = mats @ np.array(getLocalOffset(tracker))
+	if target.bl_rna.name == 'Pose Bone':
+		# Depends on the armature state, so no bulk conversion
+		for i in range(len(mats)):
+			mats[i] = target.id_data.convert_space(pose_bone=target, matrix=Matrix(mats[i]), from_space='WORLD', to_space='LOCAL')
+	loc = mats[:,:3,3]
+	if target.rotation_mode == 'QUATERNION':
+		rot = matricesToQuaternions(mats[:,:3,:3])
+		# Bulk make_compatible, flipping each quaternion that points away from its (already flipped) predecessor
+		dots = np.einsum('ij,ij->i', rot, np.concatenate(([tuple(old_rot)], rot[:-1])))
+		rot *= np.cumprod(np.where(dots < 0, -1, 1))[:,None]
+	else:
+		rot = np.empty((len(mats), 3))
+		for i in range(len(mats)):
+			old_rot = Matrix(mats[i,:3,:3]).to_euler(target.rotation_euler.order, old_rot)
+			rot[i] = old_rot
+	return loc, rot
+
+def hasRecording():
+	if native_recorder and native_recording:
+		return True
+	return bool(recording_database)
+
+def getRecordedSamples(path):
+	"""Returns recorded frames, positions and quaternions (x, y, z, w) of a tracker, or None"""
+	if native_recorder and native_recording:
+		if not path in native_indices: return None
+		samples = np.asarray(native_recorder.samples(native_indices[path]))
+		startTime, startFrame, fps = native_recording
+		frames = (samples[:,0] - startTime) * fps + startFrame
+		return frames, samples[:,1:4], samples[:,4:8]
+	if not recording_database or not path in recording_database:
+		return None
+	db = recording_database[path]
+	frames = np.array([record.frame for record in db])
+	pos = np.array([tuple(record.mat.to_translation()) for record in db])
+	quat = np.array([(q.x, q.y, q.z, q.w) for q in (record.mat.to_quaternion() for record in db)])
+	return frames, pos, quat
+
+def replaceKeyframes(fcurve, co):
+	"""Replaces keyframes of fcurve within the range of the interleaved frames and values co, keeping all others"""
+	points = fcurve.keyframe_points
+	existing = np.empty(len(points)*2, dtype=np.float32)
+	points.foreach_get("co", existing)
+	inside = (existing[0::2] >= co[0]) & (existing[0::2] <= co[-2])
+	for index in np.flatnonzero(inside)[::-1]:
+		points.remove(points[int(index)], fast=True)
+	# New points are appended, so set them after the remaining ones and let update sort them and set handles
+	points.add(len(co)//2)
+	points.foreach_set("co", np.concatenate((existing.reshape(-1,2)[~inside].ravel(), co)))
+	fcurve.update()
+
+def applyRecordingToKeyframes(context, minFrame=None):
+	settings = context.scene.VRPNSettings
+	for tracker in settings.trackers:
+		target = getTrackerTarget(tracker)
+		if not target:
+			print("No target for tracker {}!".format(tracker.label))
+			continue
+		recorded = getRecordedSamples(tracker.vrpnPath)
+		if recorded is None:
+			print("No internal recording for tracker {}!".format(tracker.label))
+			continue
+		frames, pos, quat = recorded
+		if minFrame is not None:
+			valid = frames >= minFrame
+			frames, pos, quat = frames[valid], pos[valid], quat[valid]
+		if len(frames) == 0: continue
+
+		applyStart = time.perf_counter()
+
+		old_rot = target.rotation_quaternion.copy() if target.rotation_mode == 'QUATERNION' else target.rotation_euler.copy()
+		loc, rot = getTargetTransforms(tracker, target, pos, quat, old_rot)
+
+		# Interleaved frame and value for each keyframe
+		co = np.empty(len(frames)*2, dtype=np.float32)
+		co[0::2] = frames
+
+		posFC, rotFC = getTargetFCurves(target)
+		for fcurves, values in ((posFC, loc), (rotFC, rot)):
+			for i in range(0,len(fcurves)):
+				co[1::2] = values[:,i]
+				replaceKeyframes(fcurves[i], co)
+
+		print("Added {} keyframes to tracker {} in {:.2f}s!".format(len(frames), tracker.label, time.perf_counter()-applyStart))
+
+def finishRecording(context):
+	global native_keyframing
+
+	if native_recorder and native_recorder.recording:
+		native_recorder.record(False)
+		if native_keyframing:
+			# Keyframes are inserted in bulk once recording ends
+			applyRecordingToKeyframes(context, native_recording[1])
+	native_keyframing = False
+
 def applyTargetTransform(target, mat):
 	if target.bl_rna.name == 'Pose Bone':
 		target.matrix = mat
@@ -181,10 +346,43 @@ def getTargetFCurves(target):
 	return pos, rot
 		
 
+def updateNativeTrackerStates(context, keyframing):
+	global native_keyframing
+
+	settings = context.scene.VRPNSettings
+	if keyframing:
+		native_keyframing = True
+
+	newData = False
+	with vrpn_lock:
+		for tracker in settings.trackers:
+			if not tracker.vrpnPath in vrpn_trackers: continue
+			trk = vrpn_trackers[tracker.vrpnPath]
+
+			# Recording happens in the background, only need the latest pose here
+			latest = native_recorder.latest(trk.nativeIndex)
+			if latest is None or latest[0] == trk.lastTime: continue
+			trk.lastTime = latest[0]
+			newData = True
+
+			if not trk.hasReceived:
+				print("First pose for tracker '{}' received at {}!".format(trk.trackerSetup.vrpnPath, latest[0]))
+				trk.firstReceiveTime = latest[0]
+				trk.hasReceived = True
+
+			target = getTrackerTarget(tracker)
+			if target and (settings.apply_pose_directly or keyframing):
+				pos, quat = latest[1], latest[2]
+				mat = Matrix.LocRotScale(Vector(pos), Quaternion((quat[3], quat[0], quat[1], quat[2])), None)
+				applyTargetTransform(target, getTargetTransform(tracker, target, mat))
+
+	return newData
+
 def updateTrackerStates(context):
 	global recording_startFrame
 	global recording_startTime
 	global recording_database
+	global native_recording
 
 	settings = context.scene.VRPNSettings
 
@@ -194,9 +392,17 @@ def updateTrackerStates(context):
 	if not recording:
 		recording_startFrame = None
 		recording_startTime = None
+		finishRecording(context)
 	elif recording_startFrame is None:
 		recording_startFrame = context.scene.frame_current
 		recording_startTime = datetime.now(timezone.utc)
+		if native_recorder:
+			native_recorder.clear()
+			native_recording = (recording_startTime.timestamp(), recording_startFrame, context.scene.render.fps)
+			native_recorder.record(True)
+
+	if native_recorder:
+		return updateNativeTrackerStates(context, recording and keyframing)
 
 	if settings.record_internally and not recording_database:
 		recording_database = defaultdict(list)
@@ -324,67 +530,11 @@ class ApplyRecording(bpy.types.Operator):
 	bl_options = {'REGISTER', 'UNDO'}
 
 	def execute(self, context):
-		if not recording_database:
+		if not hasRecording():
 			return { 'CANCELLED' }
 
-		settings = context.scene.VRPNSettings
-		for tracker in settings.trackers:
-			target = getTrackerTarget(tracker)
-			if not target:
-				print("No target for tracker {}!".format(tracker.label))
-				continue
-			if not tracker.vrpnPath in recording_database:
-				print("No internal recording for tracker {}!".format(tracker.label))
-				continue
-			db = recording_database[tracker.vrpnPath]
-
-			old_rot = target.rotation_quaternion.copy() if target.rotation_mode == 'QUATERNION' else target.rotation_euler.copy()
-
-			posArr = [
-				array.array('f', [0])*(2*len(db)),
-				array.array('f', [0])*(2*len(db)),
-				array.array('f', [0])*(2*len(db))
-			]
-			rotArr = [
-				array.array('f', [0])*(2*len(db)),
-				array.array('f', [0])*(2*len(db)),
-				array.array('f', [0])*(2*len(db)),
-				array.array('f', [0])*(2*len(db))
-			]
-
-			print("Adding {} keyframes to tracker {}!".format(len(db), tracker.label))
-
-			for i, record in enumerate(db):
-				# Prepare transform values
-				tgt_mat = getTargetTransform(tracker, target, record.mat)
-				pos = tgt_mat.to_translation()
-				if target.rotation_mode == 'QUATERNION':
-					rot = tgt_mat.to_quaternion()
-					rot.make_compatible(old_rot)
-				else:
-					rot = tgt_mat.to_euler(target.rotation_euler.order, old_rot)
-				old_rot = rot
-
-				for j, d in enumerate(pos):
-					posArr[j][i*2+0] = record.frame
-					posArr[j][i*2+1] = d
-				for j, d in enumerate(rot):
-					rotArr[j][i*2+0] = record.frame
-					rotArr[j][i*2+1] = d
-
-			posFC, rotFC = getTargetFCurves(target)
-			for i in range(0,len(posFC)):
-				posFC[i].keyframe_points.clear()
-				#pre = len(posFC[i].keyframe_points)
-				posFC[i].keyframe_points.add(len(db))
-				#for j in range(pre, len(posFC[i].keyframe_points)):
-				#	setattr(posFC[i].keyframe_points[j], "co", some_seq[i])
-				posFC[i].keyframe_points.foreach_set("co", posArr[i])
-			for i in range(0,len(rotFC)):
-				rotFC[i].keyframe_points.clear()
-				rotFC[i].keyframe_points.add(len(db))
-				rotFC[i].keyframe_points.foreach_set("co", rotArr[i])
-			
+		applyRecordingToKeyframes(context)
+
 		return {'FINISHED'}
 
 class RequestTracking(bpy.types.Operator):
@@ -404,7 +554,7 @@ class RequestTracking(bpy.types.Operator):
 		return self.execute(context)
 
 	def execute(self, context):
-		if not recording_database:
+		if not hasRecording():
 			return { 'CANCELLED' }
 		settings = context.scene.VRPNSettings
 		for tracker in settings.trackers:
@@ -412,22 +562,23 @@ class RequestTracking(bpy.types.Operator):
 			if not target:
 				print("No target for tracker {}!".format(tracker.label))
 				continue
-			if not tracker.vrpnPath in recording_database:
+			recorded = getRecordedSamples(tracker.vrpnPath)
+			if recorded is None:
 				print("No internal recording for tracker {}!".format(tracker.label))
 				continue
-			db = recording_database[tracker.vrpnPath]
-			index = bisect.bisect_left(db, self.reqFrame, key=lambda rec: rec.frame)
-			frames = []
-			if index > 0: frames.append(index-1)
-			if index < len(db): frames.append(index)
-			for f in frames:
-				record = db[f]
-				applyTargetTransform(target, getTargetTransform(tracker, target, record.mat))
-				target.keyframe_insert('location', frame=record.frame)
+			frames, pos, quat = recorded
+			index = np.searchsorted(frames, self.reqFrame)
+			indices = []
+			if index > 0: indices.append(index-1)
+			if index < len(frames): indices.append(index)
+			for f in indices:
+				mat = Matrix.LocRotScale(Vector(pos[f]), Quaternion((quat[f][3], quat[f][0], quat[f][1], quat[f][2])), None)
+				applyTargetTransform(target, getTargetTransform(tracker, target, mat))
+				target.keyframe_insert('location', frame=frames[f])
 				if target.rotation_mode == 'QUATERNION':
-					target.keyframe_insert('rotation_quaternion', frame=record.frame)
+					target.keyframe_insert('rotation_quaternion', frame=frames[f])
 				else:
-					target.keyframe_insert('rotation_euler', frame=record.frame)
+					target.keyframe_insert('rotation_euler', frame=frames[f])
 		context.scene.frame_float = self.reqFrame
 
 		return {'FINISHED'}
@@ -483,8 +634,14 @@ class VRPNStreamingPanel(bpy.types.Panel):
 		layout.prop(settings, 'record_keyframes')
 		layout.prop(settings, 'record_internally')
 
+		if vrpn_recorder:
+			row = layout.row()
+			row.enabled = native_recorder is None
+			row.prop(settings, 'record_minutes')
+			row.prop(settings, 'record_rate')
+
 		row = layout.row()
-		row.enabled = recording_database is not None
+		row.enabled = hasRecording()
 		row.operator(ApplyRecording.bl_idname, text="Apply Recording to Keyframes")
 
 		row = layout.row()
@@ -569,6 +726,10 @@ class VRPNSettings(bpy.types.PropertyGroup):
 	record_keyframes: bpy.props.BoolProperty(name="Record Keyframes", default=False)
 	record_internally: bpy.props.BoolProperty(name="Record Internally", default=False)
 
+	# Capacity of native recorder per tracker, preallocated once streaming starts
+	record_minutes: bpy.props.IntProperty(name="Max Minutes", default=15, min=1)
+	record_rate: bpy.props.IntProperty(name="Max Rate", default=240, min=1)
+
 def register():
 	bpy.utils.register_class(VRPNStreamingPanel)
 	bpy.utils.register_class(VRPNTrackerSetup)
@@ -0,0 +1,514 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Event-driven VRPN tracker for python, complementing the VRPN python bindings
+ * Instead of spinning on mainloop(), python blocks in wait(timeout) or selects on fileno() (e.g. with asyncio)
+ * A background thread blocks on the connection and queues reports, which mainloop() passes to the callbacks
+ * Trackers on the same server share their connection, and thus one thread servicing it
+ *
+ *	tracker = vrpn_receiver.Tracker("Tracker0@localhost")
+ *	tracker.register_change_handler(userdata, callback, "position")	# Same reports as vrpn.receiver.Tracker
+ *	while True:
+ *		if tracker.wait(1.0):	# Or select/asyncio on tracker.fileno()
+ *			tracker.mainloop()
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <datetime.h>
+
+#include "vrpn_service.hpp"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+enum ReportType { Position = 0, Velocity = 1, ReportTypeCount };
+static const char *ReportTypeNames[ReportTypeCount] = { "position", "velocity" };
+
+struct Report
+{
+	ReportType type;
+	int sensor;
+	timeval time;
+	double values[8]; // Position + quaternion, or velocity + quaternion + dt
+};
+
+struct ConnectionService;
+
+struct ReceiverState
+{
+	std::unique_ptr<vrpn_Tracker_Remote> remote; // Only touched by its service thread, or with the service locked
+	ConnectionService *service = nullptr;
+	std::atomic<bool> wanted[ReportTypeCount] = {}; // Only queue reports python has handlers for
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::deque<Report> reports;
+	std::size_t dropped = 0;
+	int pipe[2] = { -1, -1 }; // Readable while reports are queued
+};
+
+/**
+ * Thread servicing a connection for all trackers using it, since a vrpn_Connection must only be used by one thread
+ * vrpn_get_connection_by_name returns the same connection for all trackers on the same server
+ */
+struct ConnectionService
+{
+	vrpn_Connection *connection = nullptr; // Holds a reference
+	std::vector<ReceiverState*> trackers; // Protected by mutex
+	std::mutex mutex; // Held by the thread while servicing the connection
+	std::atomic<int> pending = 0;
+	std::atomic<bool> running = true;
+	std::thread thread;
+};
+
+// Services by connection, only modified while holding ServicesMutex
+static std::mutex ServicesMutex;
+static std::unordered_map<vrpn_Connection*, std::unique_ptr<ConnectionService>> Services;
+
+enum { MaxQueuedReports = 65536 };
+
+typedef struct
+{
+	PyObject_HEAD
+	ReceiverState *state;
+	PyObject *handlers; // List of (type, userdata, callback)
+} Tracker;
+
+
+/*
+ * Receiving thread, never touches python objects
+ */
+
+static void queueReport(ReceiverState *state, const Report &report)
+{
+	std::unique_lock lock(state->mutex);
+	bool wasEmpty = state->reports.empty();
+	if (state->reports.size() >= MaxQueuedReports)
+	{ // Python is not keeping up, drop oldest
+		state->reports.pop_front();
+		state->dropped++;
+	}
+	state->reports.push_back(report);
+	if (!wasEmpty) return;
+	lock.unlock();
+	state->wakeup.notify_all();
+#ifndef _WIN32
+	char signal = 1;
+	[[maybe_unused]] ssize_t written = write(state->pipe[1], &signal, 1);
+#endif
+}
+
+static void VRPN_CALLBACK handlePosition(void *data, const vrpn_TRACKERCB t)
+{
+	ReceiverState *state = (ReceiverState*)data;
+	if (!state->wanted[Position].load(std::memory_order_relaxed)) return;
+	queueReport(state, Report{ Position, t.sensor, t.msg_time,
+		{ t.pos[0], t.pos[1], t.pos[2], t.quat[0], t.quat[1], t.quat[2], t.quat[3], 0 } });
+}
+
+static void VRPN_CALLBACK handleVelocity(void *data, const vrpn_TRACKERVELCB t)
+{
+	ReceiverState *state = (ReceiverState*)data;
+	if (!state->wanted[Velocity].load(std::memory_order_relaxed)) return;
+	queueReport(state, Report{ Velocity, t.sensor, t.msg_time,
+		{ t.vel[0], t.vel[1], t.vel[2], t.vel_quat[0], t.vel_quat[1], t.vel_quat[2], t.vel_quat[3], t.vel_quat_dt } });
+}
+
+static std::unique_lock<std::mutex> acquireService(ConnectionService *service)
+{ // Makes the service thread yield once its current wait ends
+	service->pending++;
+	std::unique_lock lock(service->mutex);
+	service->pending--;
+	return lock;
+}
+
+static void serviceThread(ConnectionService *service)
+{
+	std::unique_lock lock(service->mutex);
+	while (service->running.load(std::memory_order_relaxed))
+	{
+		if (service->pending.load() > 0)
+		{ // Let trackers be added or removed first
+			lock.unlock();
+			while (service->pending.load() > 0)
+				std::this_thread::yield();
+			lock.lock();
+			continue;
+		}
+		// Only wakes up when reports arrive, or to check whether to stop
+		waitConnection(service->connection, 50);
+		for (ReceiverState *state : service->trackers)
+			state->remote->mainloop();
+	}
+}
+
+/**
+ * Create the remote of a tracker on the service of its connection, starting the service if needed
+ */
+static bool attachTracker(ReceiverState *state, const char *path)
+{
+	std::unique_lock servicesLock(ServicesMutex);
+	vrpn_Connection *connection = vrpn_get_connection_by_name(path);
+	if (!connection) return false;
+	auto &service = Services[connection];
+	if (!service)
+	{
+		service = std::make_unique<ConnectionService>();
+		service->connection = connection;
+		service->thread = std::thread(serviceThread, service.get());
+	}
+	else // Service already holds a reference
+		connection->removeReference();
+	auto lock = acquireService(service.get());
+	state->remote = std::make_unique<vrpn_Tracker_Remote>(path, connection);
+	state->remote->register_change_handler(state, handlePosition);
+	state->remote->register_change_handler(state, handleVelocity);
+	state->service = service.get();
+	service->trackers.push_back(state);
+	return true;
+}
+
+/**
+ * Remove the remote of a tracker from its service, stopping the service once no tracker uses it anymore
+ */
+static void detachTracker(ReceiverState *state)
+{
+	ConnectionService *service = state->service;
+	if (!service) return;
+	std::unique_lock servicesLock(ServicesMutex);
+	{
+		auto lock = acquireService(service);
+		service->trackers.erase(std::remove(service->trackers.begin(), service->trackers.end(), state), service->trackers.end());
+		state->remote = nullptr;
+		state->service = nullptr;
+		if (!service->trackers.empty()) return;
+		service->running = false;
+	}
+	service->thread.join();
+	service->connection->removeReference();
+	Services.erase(service->connection);
+}
+
+
+/*
+ * Python interface
+ */
+
+static PyObject *buildTime(const timeval &time)
+{ // Naive UTC datetime, like the VRPN python bindings
+	time_t seconds = time.tv_sec;
+	struct tm utc;
+#ifdef _WIN32
+	gmtime_s(&utc, &seconds);
+#else
+	gmtime_r(&seconds, &utc);
+#endif
+	return PyDateTime_FromDateAndTime(utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+		utc.tm_hour, utc.tm_min, utc.tm_sec, time.tv_usec);
+}
+
+static PyObject *buildReport(const Report &report)
+{
+	PyObject *time = buildTime(report.time);
+	if (!time) return NULL;
+	const double *v = report.values;
+	PyObject *dict;
+	if (report.type == Position)
+		dict = Py_BuildValue("{s:i,s:N,s:(ddd),s:(dddd)}", "sensor", report.sensor, "time", time,
+			"position", v[0], v[1], v[2], "quaternion", v[3], v[4], v[5], v[6]);
+	else
+		dict = Py_BuildValue("{s:i,s:N,s:(ddd),s:(dddd),s:d}", "sensor", report.sensor, "time", time,
+			"velocity", v[0], v[1], v[2], "future quaternion", v[3], v[4], v[5], v[6], "future delta", v[7]);
+	return dict;
+}
+
+static void closeState(ReceiverState *state)
+{
+	detachTracker(state);
+	state->wakeup.notify_all();
+#ifndef _WIN32
+	if (state->pipe[0] >= 0) close(state->pipe[0]);
+	if (state->pipe[1] >= 0) close(state->pipe[1]);
+#endif
+	delete state;
+}
+
+static int Tracker_init(Tracker *self, PyObject *args, PyObject *kwds)
+{
+	static const char *kwlist[] = { "path", NULL };
+	const char *path;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s", (char**)kwlist, &path))
+		return -1;
+	if (self->state)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Tracker is already initialised");
+		return -1;
+	}
+	auto state = std::make_unique<ReceiverState>();
+#ifndef _WIN32
+	if (pipe(state->pipe) != 0)
+	{
+		PyErr_SetFromErrno(PyExc_OSError);
+		return -1;
+	}
+	fcntl(state->pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(state->pipe[1], F_SETFL, O_NONBLOCK);
+#endif
+	bool attached;
+	Py_BEGIN_ALLOW_THREADS
+	// Connects in the background, will be serviced by the thread of its connection
+	attached = attachTracker(state.get(), path);
+	Py_END_ALLOW_THREADS
+	if (!attached)
+	{
+		PyErr_Format(PyExc_ValueError, "Failed to create connection for '%s'", path);
+		closeState(state.release());
+		return -1;
+	}
+	self->handlers = PyList_New(0);
+	if (!self->handlers)
+	{
+		closeState(state.release());
+		return -1;
+	}
+	self->state = state.release();
+	return 0;
+}
+
+static void Tracker_dealloc(Tracker *self)
+{
+	if (self->state)
+	{
+		Py_BEGIN_ALLOW_THREADS
+		closeState(self->state);
+		Py_END_ALLOW_THREADS
+	}
+	Py_XDECREF(self->handlers);
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static bool checkOpen(Tracker *self)
+{
+	if (self->state) return true;
+	PyErr_SetString(PyExc_ValueError, "Tracker is closed");
+	return false;
+}
+
+static PyObject *Tracker_register_change_handler(Tracker *self, PyObject *args)
+{
+	PyObject *userdata, *callback;
+	const char *typeName = "position";
+	if (!PyArg_ParseTuple(args, "OO|s", &userdata, &callback, &typeName))
+		return NULL;
+	if (!checkOpen(self)) return NULL;
+	if (!PyCallable_Check(callback))
+	{
+		PyErr_SetString(PyExc_TypeError, "Callback must be callable");
+		return NULL;
+	}
+	int type = -1;
+	for (int i = 0; i < ReportTypeCount; i++)
+		if (strcmp(typeName, ReportTypeNames[i]) == 0) type = i;
+	if (type < 0)
+	{
+		PyErr_Format(PyExc_ValueError, "Unsupported report type '%s', expected 'position' or 'velocity'", typeName);
+		return NULL;
+	}
+	PyObject *handler = Py_BuildValue("(iOO)", type, userdata, callback);
+	if (!handler || PyList_Append(self->handlers, handler) < 0)
+	{
+		Py_XDECREF(handler);
+		return NULL;
+	}
+	Py_DECREF(handler);
+	self->state->wanted[type] = true;
+	Py_RETURN_NONE;
+}
+
+static PyObject *Tracker_mainloop(Tracker *self, PyObject *Py_UNUSED(args))
+{
+	if (!checkOpen(self)) return NULL;
+	ReceiverState *state = self->state;
+	std::deque<Report> reports;
+	{
+		std::unique_lock lock(state->mutex);
+		std::swap(reports, state->reports);
+#ifndef _WIN32
+		// Queue is empty, so fileno is no longer readable
+		char signals[64];
+		while (read(state->pipe[0], signals, sizeof(signals)) > 0);
+#endif
+	}
+	for (auto &report : reports)
+	{
+		PyObject *dict = NULL;
+		for (Py_ssize_t i = 0; i < PyList_GET_SIZE(self->handlers); i++)
+		{
+			PyObject *handler = PyList_GET_ITEM(self->handlers, i);
+			if (PyLong_AsLong(PyTuple_GET_ITEM(handler, 0)) != report.type) continue;
+			if (!dict && !(dict = buildReport(report)))
+				return NULL;
+			PyObject *result = PyObject_CallFunctionObjArgs(PyTuple_GET_ITEM(handler, 2), PyTuple_GET_ITEM(handler, 1), dict, NULL);
+			if (!result)
+			{ // Remaining reports are discarded
+				Py_DECREF(dict);
+				return NULL;
+			}
+			Py_DECREF(result);
+		}
+		Py_XDECREF(dict);
+	}
+	return PyLong_FromSize_t(reports.size());
+}
+
+static PyObject *Tracker_wait(Tracker *self, PyObject *args)
+{
+	PyObject *timeoutObj = Py_None;
+	if (!PyArg_ParseTuple(args, "|O", &timeoutObj))
+		return NULL;
+	if (!checkOpen(self)) return NULL;
+	double timeout = -1;
+	if (timeoutObj != Py_None)
+	{
+		timeout = PyFloat_AsDouble(timeoutObj);
+		if (timeout == -1 && PyErr_Occurred()) return NULL;
+		timeout = std::max(timeout, 0.0);
+	}
+	ReceiverState *state = self->state;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(std::max(timeout, 0.0)*1000000));
+	while (true)
+	{
+		bool pending;
+		Py_BEGIN_ALLOW_THREADS
+		// Wait in slices to handle signals like KeyboardInterrupt in between
+		auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+		if (timeout >= 0) until = std::min(until, deadline);
+		std::unique_lock lock(state->mutex);
+		pending = state->wakeup.wait_until(lock, until, [&]{ return !state->reports.empty(); });
+		Py_END_ALLOW_THREADS
+		if (pending) Py_RETURN_TRUE;
+		if (timeout >= 0 && std::chrono::steady_clock::now() >= deadline) Py_RETURN_FALSE;
+		if (PyErr_CheckSignals() < 0) return NULL;
+	}
+}
+
+static PyObject *Tracker_fileno(Tracker *self, PyObject *Py_UNUSED(args))
+{
+	if (!checkOpen(self)) return NULL;
+#ifndef _WIN32
+	return PyLong_FromLong(self->state->pipe[0]);
+#else
+	PyErr_SetString(PyExc_NotImplementedError, "fileno is not supported on Windows, use wait instead");
+	return NULL;
+#endif
+}
+
+static PyObject *Tracker_dropped(Tracker *self, PyObject *Py_UNUSED(args))
+{
+	if (!checkOpen(self)) return NULL;
+	std::unique_lock lock(self->state->mutex);
+	return PyLong_FromSize_t(self->state->dropped);
+}
+
+static PyObject *Tracker_close(Tracker *self, PyObject *Py_UNUSED(args))
+{
+	if (self->state)
+	{
+		ReceiverState *state = self->state;
+		self->state = NULL;
+		Py_BEGIN_ALLOW_THREADS
+		closeState(state);
+		Py_END_ALLOW_THREADS
+	}
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef Tracker_methods[] = {
+	{ "register_change_handler", (PyCFunction)Tracker_register_change_handler, METH_VARARGS,
+		"Register callback(userdata, report) for 'position' (default) or 'velocity' reports" },
+	{ "mainloop", (PyCFunction)Tracker_mainloop, METH_NOARGS, "Pass all queued reports to the callbacks, returns number of reports" },
+	{ "wait", (PyCFunction)Tracker_wait, METH_VARARGS, "Block until reports are queued or the timeout (seconds, None to wait indefinitely) passes, returns whether reports are queued" },
+	{ "fileno", (PyCFunction)Tracker_fileno, METH_NOARGS, "File descriptor that is readable while reports are queued (not on Windows)" },
+	{ "dropped", (PyCFunction)Tracker_dropped, METH_NOARGS, "Number of reports dropped because mainloop was not called often enough" },
+	{ "close", (PyCFunction)Tracker_close, METH_NOARGS, "Disconnect and stop receiving" },
+	{ NULL }
+};
+
+static PyTypeObject TrackerType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"vrpn_receiver.Tracker"
+};
+
+static PyModuleDef ReceiverModule = {
+	PyModuleDef_HEAD_INIT,
+	"vrpn_receiver",
+	"Event-driven VRPN trackers that wait for reports instead of spinning",
+	-1
+};
+
+PyMODINIT_FUNC PyInit_vrpn_receiver()
+{
+	PyDateTime_IMPORT;
+	if (!PyDateTimeAPI)
+		return NULL;
+
+	TrackerType.tp_basicsize = sizeof(Tracker);
+	TrackerType.tp_flags = Py_TPFLAGS_DEFAULT;
+	TrackerType.tp_doc = "Receives a VRPN tracker on a background thread, queueing reports for mainloop";
+	TrackerType.tp_new = PyType_GenericNew;
+	TrackerType.tp_init = (initproc)Tracker_init;
+	TrackerType.tp_dealloc = (destructor)Tracker_dealloc;
+	TrackerType.tp_methods = Tracker_methods;
+	if (PyType_Ready(&TrackerType) < 0)
+		return NULL;
+
+	PyObject *module = PyModule_Create(&ReceiverModule);
+	if (!module) return NULL;
+	Py_INCREF(&TrackerType);
+	if (PyModule_AddObject(module, "Tracker", (PyObject*)&TrackerType) < 0)
+	{
+		Py_DECREF(&TrackerType);
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
+}
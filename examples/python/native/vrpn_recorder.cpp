@@ -0,0 +1,463 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * Native VRPN recorder for the Blender integration (blender_vrpn.py)
+ * Receives trackers on background threads, independent of the GIL, and records all poses into preallocated
+ * contiguous arrays, which python can access without copies through the buffer protocol (e.g. numpy.asarray)
+ *
+ *	rec = vrpn_recorder.Recorder(capacity)	# Max samples recorded per tracker
+ *	index = rec.add("Tracker0@localhost")	# Only while stopped
+ *	rec.start(); rec.record(True)
+ *	rec.latest(index)						# (time, (px, py, pz), (qx, qy, qz, qw)) or None
+ *	samples = numpy.asarray(rec.samples(index))	# float64 [count, 8] of time, px, py, pz, qx, qy, qz, qw
+ *	rec.record(False); rec.stop()
+ *
+ * Times are seconds of the system clock (since unix epoch) as sent by the server
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "vrpn_service.hpp"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+enum { SampleValues = 8 };
+
+struct RecordedTracker
+{
+	std::string path;
+	std::unique_ptr<vrpn_Tracker_Remote> remote;
+	const std::atomic<bool> *recording;
+	Py_ssize_t capacity;
+	std::unique_ptr<double[]> samples; // Preallocated, never moves while the recorder exists
+	std::atomic<Py_ssize_t> count = 0; // Written by its receiving thread only
+	std::atomic<Py_ssize_t> dropped = 0;
+
+	// Protects latest pose and writes to samples
+	std::mutex mutex;
+	bool received = false; // Latest pose is updated even while not recording
+	double latest[SampleValues];
+};
+
+struct RecorderState
+{
+	Py_ssize_t capacity;
+	std::vector<std::unique_ptr<RecordedTracker>> trackers;
+	std::vector<std::thread> threads; // One per connection
+	std::atomic<bool> running = false, recording = false;
+};
+
+typedef struct
+{
+	PyObject_HEAD
+	RecorderState *state;
+	Py_ssize_t exports; // Number of live sample views, samples may not be cleared while in use
+} Recorder;
+
+typedef struct
+{
+	PyObject_HEAD
+	Recorder *recorder;
+	RecordedTracker *tracker;
+	Py_ssize_t shape[2], strides[2];
+} Samples;
+
+
+/*
+ * Receiving threads, never touch python objects
+ */
+
+static void VRPN_CALLBACK handlePose(void *data, const vrpn_TRACKERCB t)
+{
+	RecordedTracker *tracker = (RecordedTracker*)data;
+	double sample[SampleValues] = {
+		t.msg_time.tv_sec + t.msg_time.tv_usec / 1000000.0,
+		t.pos[0], t.pos[1], t.pos[2],
+		t.quat[0], t.quat[1], t.quat[2], t.quat[3]
+	};
+	std::unique_lock lock(tracker->mutex);
+	std::copy(sample, sample+SampleValues, tracker->latest);
+	tracker->received = true;
+	if (!tracker->recording->load(std::memory_order_relaxed)) return;
+	Py_ssize_t index = tracker->count.load(std::memory_order_relaxed);
+	if (index >= tracker->capacity)
+	{
+		tracker->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	std::copy(sample, sample+SampleValues, &tracker->samples[index*SampleValues]);
+	// Readers only access samples below count
+	tracker->count.store(index+1, std::memory_order_release);
+}
+
+static void receiveThread(RecorderState *state, std::vector<RecordedTracker*> trackers)
+{
+	vrpn_Connection *connection = trackers.front()->remote->connectionPtr();
+	while (state->running.load(std::memory_order_relaxed))
+	{
+		// Only wakes up when poses arrive, or to check whether to stop
+		waitConnection(connection, 100);
+		for (auto *tracker : trackers)
+			tracker->remote->mainloop();
+	}
+}
+
+
+/*
+ * Sample views, exposing recorded samples through the buffer protocol
+ */
+
+static int Samples_getbuffer(Samples *self, Py_buffer *view, int flags)
+{
+	if (flags & PyBUF_WRITABLE)
+	{
+		PyErr_SetString(PyExc_BufferError, "Recorded samples are read-only");
+		view->obj = NULL;
+		return -1;
+	}
+	view->obj = (PyObject*)self;
+	Py_INCREF(self);
+	view->buf = self->tracker->samples.get();
+	view->len = self->shape[0] * self->shape[1] * sizeof(double);
+	view->readonly = 1;
+	view->itemsize = sizeof(double);
+	view->format = (flags & PyBUF_FORMAT)? (char*)"d" : NULL;
+	view->ndim = (flags & PyBUF_ND)? 2 : 1;
+	view->shape = (flags & PyBUF_ND)? self->shape : NULL;
+	view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES? self->strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	return 0;
+}
+
+static void Samples_dealloc(Samples *self)
+{
+	self->recorder->exports--;
+	Py_DECREF(self->recorder);
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static Py_ssize_t Samples_length(Samples *self)
+{
+	return self->shape[0];
+}
+
+static PyBufferProcs Samples_as_buffer = {
+	(getbufferproc)Samples_getbuffer,
+	NULL
+};
+
+static PySequenceMethods Samples_as_sequence = {
+	(lenfunc)Samples_length
+};
+
+static PyTypeObject SamplesType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"vrpn_recorder.Samples"
+};
+
+
+/*
+ * Recorder
+ */
+
+static RecordedTracker *getTracker(Recorder *self, Py_ssize_t index)
+{
+	if (index < 0 || index >= (Py_ssize_t)self->state->trackers.size())
+	{
+		PyErr_SetString(PyExc_IndexError, "Invalid tracker index");
+		return NULL;
+	}
+	return self->state->trackers[index].get();
+}
+
+static void stopThread(RecorderState *state)
+{
+	state->running = false;
+	for (auto &thread : state->threads)
+		thread.join();
+	state->threads.clear();
+}
+
+static int Recorder_init(Recorder *self, PyObject *args, PyObject *kwds)
+{
+	static const char *kwlist[] = { "capacity", NULL };
+	Py_ssize_t capacity;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "n", (char**)kwlist, &capacity))
+		return -1;
+	if (capacity <= 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "Capacity must be positive");
+		return -1;
+	}
+	if (self->state)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Recorder is already initialised");
+		return -1;
+	}
+	self->state = new RecorderState();
+	self->state->capacity = capacity;
+	self->exports = 0;
+	return 0;
+}
+
+static void Recorder_dealloc(Recorder *self)
+{
+	if (self->state)
+	{
+		Py_BEGIN_ALLOW_THREADS
+		stopThread(self->state);
+		delete self->state;
+		Py_END_ALLOW_THREADS
+	}
+	Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject *Recorder_add(Recorder *self, PyObject *args)
+{
+	const char *path;
+	if (!PyArg_ParseTuple(args, "s", &path))
+		return NULL;
+	if (self->state->running)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Cannot add trackers while running");
+		return NULL;
+	}
+	auto tracker = std::make_unique<RecordedTracker>();
+	tracker->path = path;
+	tracker->recording = &self->state->recording;
+	tracker->capacity = self->state->capacity;
+	tracker->samples = std::unique_ptr<double[]>(new (std::nothrow) double[self->state->capacity*SampleValues]);
+	if (!tracker->samples)
+		return PyErr_NoMemory();
+	Py_BEGIN_ALLOW_THREADS
+	// Connects in the background, will be serviced by a receiving thread
+	tracker->remote = std::make_unique<vrpn_Tracker_Remote>(path);
+	tracker->remote->register_change_handler(tracker.get(), handlePose);
+	Py_END_ALLOW_THREADS
+	self->state->trackers.push_back(std::move(tracker));
+	return PyLong_FromSsize_t(self->state->trackers.size()-1);
+}
+
+static PyObject *Recorder_start(Recorder *self, PyObject *Py_UNUSED(args))
+{
+	if (!self->state->running)
+	{
+		self->state->running = true;
+		std::vector<RecordedTracker*> trackers;
+		for (auto &tracker : self->state->trackers)
+			trackers.push_back(tracker.get());
+		auto groups = groupByConnection(trackers, [](RecordedTracker *tracker){ return tracker->remote.get(); });
+		for (auto &group : groups)
+			self->state->threads.emplace_back(receiveThread, self->state, std::move(group));
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *Recorder_stop(Recorder *self, PyObject *Py_UNUSED(args))
+{
+	Py_BEGIN_ALLOW_THREADS
+	stopThread(self->state);
+	Py_END_ALLOW_THREADS
+	Py_RETURN_NONE;
+}
+
+static PyObject *Recorder_record(Recorder *self, PyObject *args)
+{
+	int record;
+	if (!PyArg_ParseTuple(args, "p", &record))
+		return NULL;
+	self->state->recording = record;
+	Py_RETURN_NONE;
+}
+
+static PyObject *Recorder_clear(Recorder *self, PyObject *Py_UNUSED(args))
+{
+	if (self->exports > 0)
+	{
+		PyErr_SetString(PyExc_BufferError, "Cannot clear samples while sample views still exist");
+		return NULL;
+	}
+	if (self->state->recording)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Cannot clear samples while recording");
+		return NULL;
+	}
+	for (auto &tracker : self->state->trackers)
+	{ // Count is only advanced while recording, with the lock held
+		std::unique_lock lock(tracker->mutex);
+		tracker->count.store(0, std::memory_order_relaxed);
+		tracker->dropped.store(0, std::memory_order_relaxed);
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject *Recorder_latest(Recorder *self, PyObject *args)
+{
+	Py_ssize_t index;
+	if (!PyArg_ParseTuple(args, "n", &index))
+		return NULL;
+	RecordedTracker *tracker = getTracker(self, index);
+	if (!tracker) return NULL;
+	double sample[SampleValues];
+	{
+		std::unique_lock lock(tracker->mutex);
+		if (!tracker->received)
+			Py_RETURN_NONE;
+		std::copy(tracker->latest, tracker->latest+SampleValues, sample);
+	}
+	return Py_BuildValue("(d(ddd)(dddd))", sample[0], sample[1], sample[2], sample[3],
+		sample[4], sample[5], sample[6], sample[7]);
+}
+
+static PyObject *Recorder_count(Recorder *self, PyObject *args)
+{
+	Py_ssize_t index;
+	if (!PyArg_ParseTuple(args, "n", &index))
+		return NULL;
+	RecordedTracker *tracker = getTracker(self, index);
+	if (!tracker) return NULL;
+	return PyLong_FromSsize_t(tracker->count.load(std::memory_order_relaxed));
+}
+
+static PyObject *Recorder_dropped(Recorder *self, PyObject *args)
+{
+	Py_ssize_t index;
+	if (!PyArg_ParseTuple(args, "n", &index))
+		return NULL;
+	RecordedTracker *tracker = getTracker(self, index);
+	if (!tracker) return NULL;
+	return PyLong_FromSsize_t(tracker->dropped.load(std::memory_order_relaxed));
+}
+
+static PyObject *Recorder_samples(Recorder *self, PyObject *args)
+{
+	Py_ssize_t index;
+	if (!PyArg_ParseTuple(args, "n", &index))
+		return NULL;
+	RecordedTracker *tracker = getTracker(self, index);
+	if (!tracker) return NULL;
+	Samples *samples = PyObject_New(Samples, &SamplesType);
+	if (!samples) return NULL;
+	Py_INCREF(self);
+	self->exports++;
+	samples->recorder = self;
+	samples->tracker = tracker;
+	// Snapshot of samples recorded so far, later samples are appended behind it
+	samples->shape[0] = tracker->count.load(std::memory_order_acquire);
+	samples->shape[1] = SampleValues;
+	samples->strides[0] = SampleValues * sizeof(double);
+	samples->strides[1] = sizeof(double);
+	return (PyObject*)samples;
+}
+
+static PyObject *Recorder_get_running(Recorder *self, void *Py_UNUSED(closure))
+{
+	return PyBool_FromLong(self->state->running);
+}
+
+static PyObject *Recorder_get_recording(Recorder *self, void *Py_UNUSED(closure))
+{
+	return PyBool_FromLong(self->state->recording);
+}
+
+static PyObject *Recorder_get_capacity(Recorder *self, void *Py_UNUSED(closure))
+{
+	return PyLong_FromSsize_t(self->state->capacity);
+}
+
+static PyMethodDef Recorder_methods[] = {
+	{ "add", (PyCFunction)Recorder_add, METH_VARARGS, "Add a tracker by its VRPN path, returns its index" },
+	{ "start", (PyCFunction)Recorder_start, METH_NOARGS, "Start receiving on background threads, one per connection" },
+	{ "stop", (PyCFunction)Recorder_stop, METH_NOARGS, "Stop receiving" },
+	{ "record", (PyCFunction)Recorder_record, METH_VARARGS, "Enable or disable recording of received poses" },
+	{ "clear", (PyCFunction)Recorder_clear, METH_NOARGS, "Discard all recorded samples" },
+	{ "latest", (PyCFunction)Recorder_latest, METH_VARARGS, "Latest pose of a tracker as (time, position, quaternion xyzw), or None" },
+	{ "count", (PyCFunction)Recorder_count, METH_VARARGS, "Number of samples recorded for a tracker" },
+	{ "dropped", (PyCFunction)Recorder_dropped, METH_VARARGS, "Number of samples dropped for a tracker after exceeding capacity" },
+	{ "samples", (PyCFunction)Recorder_samples, METH_VARARGS, "Read-only float64 [count, 8] buffer of recorded samples of a tracker" },
+	{ NULL }
+};
+
+static PyGetSetDef Recorder_getset[] = {
+	{ "running", (getter)Recorder_get_running, NULL, "Whether the receiving threads are running", NULL },
+	{ "recording", (getter)Recorder_get_recording, NULL, "Whether received poses are recorded", NULL },
+	{ "capacity", (getter)Recorder_get_capacity, NULL, "Max samples recorded per tracker", NULL },
+	{ NULL }
+};
+
+static PyTypeObject RecorderType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"vrpn_recorder.Recorder"
+};
+
+static PyModuleDef RecorderModule = {
+	PyModuleDef_HEAD_INIT,
+	"vrpn_recorder",
+	"Records VRPN trackers into contiguous arrays off the GIL",
+	-1
+};
+
+PyMODINIT_FUNC PyInit_vrpn_recorder()
+{
+	SamplesType.tp_basicsize = sizeof(Samples);
+	SamplesType.tp_flags = Py_TPFLAGS_DEFAULT;
+	SamplesType.tp_doc = "Recorded samples of a tracker, usable with numpy.asarray";
+	SamplesType.tp_dealloc = (destructor)Samples_dealloc;
+	SamplesType.tp_as_buffer = &Samples_as_buffer;
+	SamplesType.tp_as_sequence = &Samples_as_sequence;
+	if (PyType_Ready(&SamplesType) < 0)
+		return NULL;
+
+	RecorderType.tp_basicsize = sizeof(Recorder);
+	RecorderType.tp_flags = Py_TPFLAGS_DEFAULT;
+	RecorderType.tp_doc = "Receives VRPN trackers on background threads and records their poses";
+	RecorderType.tp_new = PyType_GenericNew;
+	RecorderType.tp_init = (initproc)Recorder_init;
+	RecorderType.tp_dealloc = (destructor)Recorder_dealloc;
+	RecorderType.tp_methods = Recorder_methods;
+	RecorderType.tp_getset = Recorder_getset;
+	if (PyType_Ready(&RecorderType) < 0)
+		return NULL;
+
+	PyObject *module = PyModule_Create(&RecorderModule);
+	if (!module) return NULL;
+	Py_INCREF(&RecorderType);
+	if (PyModule_AddObject(module, "Recorder", (PyObject*)&RecorderType) < 0)
+	{
+		Py_DECREF(&RecorderType);
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
+}
@@ -0,0 +1,74 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef VRPN_SERVICE_H
+#define VRPN_SERVICE_H
+
+#include "vrpn_Connection.h"
+#include "vrpn_Tracker.h"
+
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Blocks until messages arrive on the connection or the timeout passes, handling all messages received
+ * VRPN client connections select() on their sockets when given a timeout, so waiting costs no CPU time
+ */
+static inline void waitConnection(vrpn_Connection *connection, int timeoutMS)
+{
+	if (connection && connection->connected())
+	{
+		timeval timeout = { timeoutMS / 1000, (timeoutMS % 1000) * 1000 };
+		connection->mainloop(&timeout);
+	}
+	else
+	{ // Connection attempts return immediately, so throttle them
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutMS, 50)));
+	}
+}
+
+/**
+ * Groups trackers by their connection, so that each group can be serviced by a thread blocking on it
+ */
+template<typename Tracker, typename GetRemote>
+static std::vector<std::vector<Tracker*>> groupByConnection(const std::vector<Tracker*> &trackers, GetRemote getRemote)
+{
+	std::vector<std::vector<Tracker*>> groups;
+	for (Tracker *tracker : trackers)
+	{
+		vrpn_Connection *connection = getRemote(tracker)->connectionPtr();
+		auto group = std::find_if(groups.begin(), groups.end(),
+			[&](auto &grp){ return getRemote(grp.front())->connectionPtr() == connection; });
+		if (group == groups.end())
+			groups.push_back({ tracker });
+		else
+			group->push_back(tracker);
+	}
+	return groups;
+}
+
+#endif // VRPN_SERVICE_H
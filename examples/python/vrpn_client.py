@@ -7,11 +7,18 @@
 #       they coincide with the sensor's)
 
 import argparse
+import asyncio
+import time
 from datetime import datetime, timezone, timedelta
 
 import sys
 sys.path.append('lib/') # Path to vrpn.so
 import vrpn
+# Event-driven trackers (see native/), waiting for reports instead of spinning
+try:
+	import vrpn_receiver
+except ImportError:
+	vrpn_receiver = None
 
 def vrpn_receiveTrackerPos(userdata, t):
 	'''This function gets called when the tracker's POSITION xform is updated.
@@ -52,6 +59,18 @@ def vrpn_receiveTrackerVel(userdata, t):
 	print('  Callback userdata =', userdata)
 
 
+async def receive_async(tracker):
+	'''Calls the callbacks whenever reports arrive, sleeping in between.
+	Any number of trackers and other IO can be handled on the same event loop.
+	'''
+	loop = asyncio.get_running_loop()
+	loop.add_reader(tracker.fileno(), tracker.mainloop)
+	try:
+		await asyncio.Event().wait()
+	finally:
+		loop.remove_reader(tracker.fileno())
+
+
 if __name__ == '__main__':
 	parser = argparse.ArgumentParser(
 										prog = 'tracker_client',
@@ -60,18 +79,41 @@ if __name__ == '__main__':
 	parser.add_argument('device', help='Name of the device (like Tracker0@localhost)')
 	args = parser.parse_args()
 
-	done = False
-
-	# Open the tracker and set its position callback handler
-	# (other choices are velocity, acceleration, unit2ssensor, workspace,
-	# tracker2room).  An optional fourth parameter selects a particular sensor
-	# from the tracker to watch.
-	tracker = vrpn.receiver.Tracker(args.device);
-	tracker.register_change_handler(None, vrpn_receiveTrackerPos, "position");
-	tracker.register_change_handler(None, vrpn_receiveTrackerVel, "velocity");
-
-	while not done:
-		# Let the traker do it's thing.
-		# It will call the callback function(s) registered above when new
-		# messages are received.
-		tracker.mainloop()
+	if vrpn_receiver:
+		# Same interface as vrpn.receiver.Tracker, but reports are received on a background thread
+		# and queued until mainloop, so we can wait for them to arrive instead of polling
+		tracker = vrpn_receiver.Tracker(args.device)
+		tracker.register_change_handler(None, vrpn_receiveTrackerPos, "position")
+		tracker.register_change_handler(None, vrpn_receiveTrackerVel, "velocity")
+
+		try:
+			if sys.platform == 'win32':
+				# No file descriptor to select on, so block in wait instead
+				while True:
+					if tracker.wait(1.0):
+						tracker.mainloop()
+			else:
+				asyncio.run(receive_async(tracker))
+		except KeyboardInterrupt:
+			pass
+		tracker.close()
+
+	else:
+		# Open the tracker and set its position callback handler
+		# (other choices are velocity, acceleration, unit2ssensor, workspace,
+		# tracker2room).  An optional fourth parameter selects a particular sensor
+		# from the tracker to watch.
+		tracker = vrpn.receiver.Tracker(args.device);
+		tracker.register_change_handler(None, vrpn_receiveTrackerPos, "position");
+		tracker.register_change_handler(None, vrpn_receiveTrackerVel, "velocity");
+
+		try:
+			while True:
+				# Let the traker do it's thing.
+				# It will call the callback function(s) registered above when new
+				# messages are received.
+				tracker.mainloop()
+				# The python bindings can not wait for messages, so poll without pinning a core
+				time.sleep(0.001)
+		except KeyboardInterrupt:
+			pass
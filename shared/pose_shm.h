@@ -0,0 +1,119 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ASTERTRACK_POSE_SHM_H
+#define ASTERTRACK_POSE_SHM_H
+
+/*
+ * Shared memory segment the AsterTrack client republishes all received poses into, for local consumers
+ * Plain C header without dependencies, to be included by any local reader (or mirrored e.g. with python struct)
+ *
+ * [at_shm_header, padded to header_size]
+ * [at_shm_tracker table with max_trackers entries at tracker_offset]
+ * [at_shm_event ring with event_count entries at event_offset]
+ *
+ * Tracker table: Latest pose of each sensor of each tracker, protected by a sequence lock per entry
+ *  - Trackers keep their slot for their lifetime, slots of removed trackers get reused
+ *  - Poses with timestamp_us 0 are invalid, either never written or cleared when their tracker was removed
+ *  - Poses are cleared within the sequence lock of the tracker, so check it around reading a pose to attribute it
+ *  - Only sensors below max_sensors are in the table, all sensors are in the event ring
+ *  - Read: s0 = sequence (acquire), skip if odd, copy, s1 = sequence (after acquire fence), retry if s0 != s1
+ *  - sequence/2 is the number of updates, so it can also be used to cheaply check for new poses
+ *
+ * Event ring: Every received pose in order of arrival, written concurrently by multiple receiving threads
+ *  - event_head is the number of events claimed so far, event i is in entry i % event_count
+ *  - Entries have sequence 0 while being written, and i+1 once event i is complete
+ *  - Read: s0 = sequence (acquire), retry later if below i+1 (not yet written), skip if above (already overwritten), copy, skip if changed
+ *
+ * All times are microseconds of the system clock (since unix epoch), all values little-endian
+ * Quaternions are in x, y, z, w order
+ */
+
+#include <stdint.h>
+
+#define AT_SHM_DEFAULT_NAME "/astertrack-poses"
+#define AT_SHM_MAGIC 0x50485341u /* ASHP */
+#define AT_SHM_VERSION 1
+#define AT_SHM_HEADER_SIZE 128
+#define AT_SHM_MAX_TRACKERS 256
+#define AT_SHM_MAX_SENSORS 16
+#define AT_SHM_EVENT_COUNT 65536 /* Power of two */
+#define AT_SHM_PATH_LENGTH 112
+
+typedef struct at_shm_header
+{
+	uint32_t magic; /* AT_SHM_MAGIC */
+	uint32_t version; /* AT_SHM_VERSION */
+	uint32_t header_size, tracker_size, pose_size, event_size;
+	uint32_t max_trackers, max_sensors, event_count;
+	uint32_t tracker_offset, event_offset;
+	uint32_t writer_pid;
+	uint32_t open; /* 0 once the writer closed the segment */
+	uint32_t reserved0;
+	int64_t start_us; /* Time the segment was created */
+	uint64_t event_head; /* Number of events claimed, on its own cache line */
+	uint8_t reserved2[56];
+} at_shm_header;
+
+typedef struct at_shm_pose
+{
+	uint32_t sequence; /* Odd while being written */
+	int32_t sensor;
+	int64_t timestamp_us; /* Time the pose was measured, as sent by the server, 0 if there is no valid pose */
+	int64_t received_us; /* Time the pose was received */
+	float position[3];
+	float rotation[4];
+	uint32_t reserved[3];
+} at_shm_pose;
+
+typedef struct at_shm_tracker
+{
+	uint32_t sequence; /* Odd while the slot is being (re)assigned */
+	uint32_t id; /* Id of the tracker, unique while the writer is running */
+	uint32_t active; /* 0 if the slot is unused */
+	uint32_t sensors; /* Upper bound of sensors that received poses */
+	char path[AT_SHM_PATH_LENGTH]; /* Null-terminated VRPN path of the tracker */
+	at_shm_pose poses[AT_SHM_MAX_SENSORS];
+} at_shm_tracker;
+
+typedef struct at_shm_event
+{
+	uint64_t sequence; /* 0 while being written, index+1 once complete */
+	uint32_t tracker; /* at_shm_tracker::id */
+	int32_t sensor;
+	int64_t timestamp_us, received_us;
+	float position[3];
+	float rotation[4];
+	uint32_t slot; /* Slot of the tracker in the tracker table, or UINT32_MAX if it has none */
+} at_shm_event;
+
+#ifdef __cplusplus
+static_assert(sizeof(at_shm_header) == AT_SHM_HEADER_SIZE, "Unexpected header size");
+static_assert(sizeof(at_shm_pose) == 64, "Unexpected pose size");
+static_assert(sizeof(at_shm_tracker) == 128 + 64*AT_SHM_MAX_SENSORS, "Unexpected tracker size");
+static_assert(sizeof(at_shm_event) == 64, "Unexpected event size");
+#endif
+
+#endif /* ASTERTRACK_POSE_SHM_H */
@@ -25,6 +25,8 @@ SOFTWARE.
 
 #include "app.hpp"
 #include "client.hpp"
+#include "headless.hpp"
+#include "log_file.hpp"
 
 #include "ui/shared.hpp" // Signals
 
@@ -33,16 +35,26 @@ SOFTWARE.
 #include "util/util.hpp" // dtUS
 
 #include <cstdio>
+#include <cstring>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 AppState AppInstance;
 ClientState StateInstance = {};
 static std::atomic<bool> quitApp = { false };
 static std::atomic<bool> closedUI = { false };
+static bool printLogs = false;
+static bool storeLogs = true;
+// Declared after AppInstance, so that it is destroyed first, writing all remaining logs
+static LogFileSink logFile;
 static TimePoint_t lastUIUpdate;
 
 
 /* Interface */
 
+#ifdef INTERFACE_LINKED
 extern "C" {
 	bool _InterfaceThread();
 	void _SignalShouldClose();
@@ -51,6 +63,12 @@ extern "C" {
 InterfaceThread_t InterfaceThread = &_InterfaceThread;
 SignalShouldClose_t SignalInterfaceShouldClose = &_SignalShouldClose;
 SignalLogUpdate_t SignalLogUpdate = &_SignalLogUpdate;
+#else
+// Headless-only build
+InterfaceThread_t InterfaceThread = nullptr;
+SignalShouldClose_t SignalInterfaceShouldClose = [](){};
+SignalLogUpdate_t SignalLogUpdate = [](){};
+#endif
 
 
 /* Logging implementation */
@@ -70,8 +88,71 @@ static void initialise_logging_strings();
 
 /* Main Server Loop */
 
-int main (void)
+static void printUsage(const char *program)
 {
+	printf("Usage: %s [options]\n", program);
+	printf("  --headless          Run without interface, printing summaries to stdout\n");
+	printf("  --summary S         Seconds between summaries in headless mode (default 5)\n");
+	printf("  --duration S        Seconds to run for in headless mode, 0 to run until interrupted (default 0)\n");
+	printf("  --record FILE       Record all received poses into capture file\n");
+	printf("  --replay FILE       Replay capture file\n");
+	printf("  --shm NAME          Republish all received poses into shared memory segment (e.g. %s)\n", AT_SHM_DEFAULT_NAME);
+	printf("  --log-entries N     Max number of log entries kept in memory, 0 for unlimited (default %lu)\n", (unsigned long)AppState::LogRetention().maxEntries);
+	printf("  --log-memory MB     Max memory used by logs, 0 for unlimited (default %lu)\n", (unsigned long)(AppState::LogRetention().maxBytes/1024/1024));
+	printf("  --log-age S         Max age of log entries kept in memory, 0 for unlimited (default 0)\n");
+	printf("  --log-file FILE     Write logs to file from a background thread\n");
+	printf("  --log-file-size MB  Size after which the log file is rotated, 0 to disable (default %lu)\n", (unsigned long)(LogFileSink::Options().maxBytes/1024/1024));
+	printf("  --log-file-count N  Number of rotated log files to keep (default %d)\n", LogFileSink::Options().maxFiles);
+	printf("  --log-compress      Compress rotated log files with gzip\n");
+}
+
+int main (int argc, char **argv)
+{
+	bool headless = InterfaceThread == nullptr;
+	HeadlessOptions headlessOptions;
+	std::string recordPath, replayPath, shmName;
+	LogFileSink::Options logFileOptions;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue = i+1 < argc;
+		if (std::strcmp(arg, "--headless") == 0)
+			headless = true;
+		else if (std::strcmp(arg, "--summary") == 0 && hasValue)
+			headlessOptions.summaryInterval = std::max(std::atof(argv[++i]), 0.1);
+		else if (std::strcmp(arg, "--duration") == 0 && hasValue)
+			headlessOptions.duration = std::atof(argv[++i]);
+		else if (std::strcmp(arg, "--record") == 0 && hasValue)
+			recordPath = argv[++i];
+		else if (std::strcmp(arg, "--replay") == 0 && hasValue)
+			replayPath = argv[++i];
+		else if (std::strcmp(arg, "--shm") == 0 && hasValue)
+			shmName = argv[++i];
+		else if (std::strcmp(arg, "--log-entries") == 0 && hasValue)
+			AppInstance.logRetention.maxEntries = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(arg, "--log-memory") == 0 && hasValue)
+			AppInstance.logRetention.maxBytes = std::strtoul(argv[++i], nullptr, 10)*1024*1024;
+		else if (std::strcmp(arg, "--log-age") == 0 && hasValue)
+			AppInstance.logRetention.maxAgeS = std::atof(argv[++i]);
+		else if (std::strcmp(arg, "--log-file") == 0 && hasValue)
+			logFileOptions.path = argv[++i];
+		else if (std::strcmp(arg, "--log-file-size") == 0 && hasValue)
+			logFileOptions.maxBytes = std::strtoul(argv[++i], nullptr, 10)*1024*1024;
+		else if (std::strcmp(arg, "--log-file-count") == 0 && hasValue)
+			logFileOptions.maxFiles = std::max(std::atoi(argv[++i]), 0);
+		else if (std::strcmp(arg, "--log-compress") == 0)
+			logFileOptions.compress = true;
+		else
+		{
+			printUsage(argv[0]);
+			return std::strcmp(arg, "--help") == 0? 0 : 1;
+		}
+	}
+	// Nobody is going to look at the logs in the interface
+	printLogs = headless;
+	// Log file is written from logs stored in memory
+	storeLogs = !headless || !logFileOptions.path.empty();
+
 	{ // Setup logging
 		initialise_logging_strings();
 
@@ -79,6 +160,12 @@ int main (void)
 		// NOTE: Compile-time LOG_MAX_LEVEL takes priority!
 		for (int i = 0; i < LMaxCategory; i++)
 			LogMaxLevelTable[i] = LOG_MAX_LEVEL_DEFAULT;
+
+		if (storeLogs)
+			AppInstance.StartLogMaintenance();
+
+		if (!logFileOptions.path.empty() && !logFile.open(logFileOptions))
+			return -1;
 	}
 
 	{ // Init AsterTrack server
@@ -89,8 +176,28 @@ int main (void)
 		});
 	}
 
+	if (!replayPath.empty() || !recordPath.empty() || !shmName.empty())
+	{
+		auto io_lock = std::unique_lock(StateInstance.io.mutex);
+		if (!replayPath.empty() && !StartReplay(StateInstance, replayPath))
+			return -1;
+		if (!recordPath.empty() && !StartCapture(StateInstance, recordPath))
+			return -1;
+		if (!shmName.empty() && !StartSharedMemory(StateInstance, shmName))
+			return -1;
+	}
+
 	LOGC(LInfo, "=======================\n");
 
+	if (headless)
+	{
+		std::signal(SIGINT, [](int){ quitApp = true; });
+		std::signal(SIGTERM, [](int){ quitApp = true; });
+		RunHeadless(StateInstance, headlessOptions, quitApp);
+		ClientExit(StateInstance);
+		exit(0);
+	}
+
 	// TODO: Setup tray icon, etc.
 
 	while (!quitApp.load())
@@ -132,6 +239,54 @@ void AppState::SignalInterfaceClosed()
 	closedUI = true;
 }
 
+void AppState::StartLogMaintenance()
+{
+	logMaintenance = std::jthread([this](std::stop_token stop_token)
+	{
+		std::mutex mutex;
+		std::condition_variable_any wakeup;
+		while (!stop_token.stop_requested())
+		{
+			ApplyLogRetention();
+			// Only deletes blocks no longer referenced by any view (e.g. of the UI), else retries next time
+			logEntries.delete_culled();
+			std::unique_lock lock(mutex);
+			wakeup.wait_for(lock, stop_token, std::chrono::seconds(1), [](){ return false; });
+		}
+	});
+}
+
+std::size_t AppState::ApplyLogRetention()
+{
+	const std::size_t N = decltype(logEntries)::BlockSize;
+	LogRetention retention = logRetention;
+	auto logs = logEntries.getView();
+	if (logs.empty()) return 0;
+
+	std::size_t first = logs.beginIndex()/N, last = (logs.endIndex()-1)/N;
+	std::size_t entries = logs.size(), memory = 0;
+	for (std::size_t b = first; b <= last; b++)
+		memory += logs.blockMemory(std::max(b*N, logs.beginIndex()));
+	TimePoint_t now = sclock::now();
+
+	// Cull whole blocks from the front, but never the block currently being written to
+	std::size_t block = first;
+	for (; block < last; block++)
+	{
+		std::size_t begin = std::max(block*N, logs.beginIndex()), end = (block+1)*N;
+		bool cull = (retention.maxEntries > 0 && entries > retention.maxEntries)
+			|| (retention.maxBytes > 0 && memory > retention.maxBytes)
+			|| (retention.maxAgeS > 0 && dtUS(logs[end-1].timestamp, now) > retention.maxAgeS*1000000);
+		if (!cull) break;
+		entries -= end - begin;
+		memory -= logs.blockMemory(begin);
+	}
+	if (block == first) return 0;
+	std::size_t culled = block*N - logs.beginIndex();
+	logEntries.cull_to(block*N);
+	return culled;
+}
+
 
 /* Logging implementation */
 
@@ -182,18 +337,203 @@ static void initialise_logging_strings()
 	std::vsnprintf(STRING.data(), size+1, FORMAT, argp); \
 	va_end(argp); \
 
+static void StoreFormattedLog(LogCategory category, LogLevel level, int context, std::string_view log)
+{
+	GetApp().logEntries.emplace_back([&](AppState::LogEntry &entry, ByteArena &arena)
+	{
+		entry.timestamp = sclock::now();
+		entry.category = category;
+		entry.level = level;
+		entry.context = context;
+		entry.payload.store(arena, log.data(), log.size());
+		entry.state.store(AppState::LogEntry::Formatted, std::memory_order_relaxed);
+	});
+
+	if (LogFilterTable[category] <= level)
+		SignalLogUpdate();
+}
+
 int PrintLog(LogCategory category, LogLevel level, int context, const char *format, ...)
 {
-	AppState::LogEntry entry = {};
-	entry.category = category;
-	entry.level = level;
-	entry.context = context;
-	FORMAT_TO_STRING(format, entry.log);
+	thread_local std::string log; // Reused to not allocate each time
+	FORMAT_TO_STRING(format, log);
 
-	GetApp().logEntries.push_back(std::move(entry));
+	if (printLogs)
+		printf("%s %s %s\n", LogCategoryIdentifiers[category], LogLevelIdentifiers[level], log.c_str());
+	if (storeLogs)
+		StoreFormattedLog(category, level, context, log);
+	return size;
+}
+
+int PrintLogDeferred(LogCategory category, LogLevel level, int context, const char *format, const LogArgs &args)
+{
+	if (printLogs)
+	{ // Printed right away anyway, so no point in deferring
+		thread_local std::string log;
+		args.format(format, log);
+		printf("%s %s %s\n", LogCategoryIdentifiers[category], LogLevelIdentifiers[level], log.c_str());
+		if (storeLogs)
+			StoreFormattedLog(category, level, context, log);
+		return log.size();
+	}
+
+	GetApp().logEntries.emplace_back([&](AppState::LogEntry &entry, ByteArena &arena)
+	{
+		entry.timestamp = sclock::now();
+		entry.category = category;
+		entry.level = level;
+		entry.context = context;
+		entry.format = format;
+		entry.payload.store(arena, args.data, args.size);
+	});
 
 	if (LogFilterTable[category] <= level)
 		SignalLogUpdate();
 
-	return size;
+	return 0;
+}
+
+std::string_view AppState::LogEntry::text(ByteArena &arena) const
+{
+	uint8_t expected = state.load(std::memory_order_acquire);
+	while (expected != Formatted)
+	{
+		if (expected == Deferred && state.compare_exchange_weak(expected, Formatting, std::memory_order_acquire))
+		{ // Format once and replace packed arguments with text
+			thread_local std::string log;
+			if (!LogArgs::format(format, (const uint8_t*)payload.data(), payload.length, log))
+				log = format;
+			payload.store(arena, log.data(), log.size());
+			state.store(Formatted, std::memory_order_release);
+			break;
+		}
+		if (expected == Formatting)
+		{ // Another thread is formatting it right now, will be quick
+			std::this_thread::yield();
+			expected = state.load(std::memory_order_acquire);
+		}
+	}
+	return payload.view();
+}
+
+
+/* Deferred log formatting */
+
+template<typename V>
+static void appendFormatted(std::string &text, const char *spec, int stars, const int star[2], V value)
+{
+	auto print = [&](char *buffer, std::size_t size)
+	{
+		if (stars == 0) return std::snprintf(buffer, size, spec, value);
+		if (stars == 1) return std::snprintf(buffer, size, spec, star[0], value);
+		return std::snprintf(buffer, size, spec, star[0], star[1], value);
+	};
+	char buffer[256];
+	int length = print(buffer, sizeof(buffer));
+	if (length < 0) return;
+	if ((std::size_t)length < sizeof(buffer))
+	{
+		text.append(buffer, length);
+		return;
+	}
+	std::size_t pos = text.size();
+	text.resize(pos + length);
+	print(text.data()+pos, length+1);
+}
+
+template<typename V>
+static inline bool readArg(const uint8_t *data, std::size_t size, std::size_t &pos, V &value)
+{
+	if (pos + sizeof(V) > size) return false;
+	std::memcpy(&value, data+pos, sizeof(V));
+	pos += sizeof(V);
+	return true;
+}
+
+template<typename V>
+static inline bool formatArg(const uint8_t *data, std::size_t size, std::size_t &pos, std::string &text, const char *spec, int stars, const int star[2])
+{
+	V value;
+	if (!readArg(data, size, pos, value)) return false;
+	appendFormatted(text, spec, stars, star, value);
+	return true;
+}
+
+bool LogArgs::format(const char *format, const uint8_t *data, std::size_t size, std::string &text)
+{
+	text.clear();
+	std::size_t pos = 0;
+	const char *f = format;
+	while (*f)
+	{
+		const char *conv = std::strchr(f, '%');
+		if (!conv)
+		{
+			text.append(f);
+			break;
+		}
+		text.append(f, conv-f);
+		if (conv[1] == '%')
+		{
+			text.push_back('%');
+			f = conv+2;
+			continue;
+		}
+
+		// Parse conversion specification: %[flags][width][.precision][length]type
+		const char *s = conv+1;
+		int stars = 0, star[2] = {};
+		while (*s && std::strchr("-+ #0", *s)) s++;
+		if (*s == '*') { stars++; s++; }
+		else while (*s >= '0' && *s <= '9') s++;
+		if (*s == '.')
+		{
+			s++;
+			if (*s == '*') { stars++; s++; }
+			else while (*s >= '0' && *s <= '9') s++;
+		}
+		while (*s && std::strchr("hljztL", *s)) s++;
+		if (!*s) return false;
+		f = s+1;
+		char spec[32];
+		if ((std::size_t)(f-conv) >= sizeof(spec)) return false;
+		std::memcpy(spec, conv, f-conv);
+		spec[f-conv] = 0;
+
+		for (int i = 0; i < stars; i++)
+		{ // Width and precision passed as int arguments
+			if (pos >= size || data[pos++] != (uint8_t)LogArgType::Int) return false;
+			if (!readArg(data, size, pos, star[i])) return false;
+		}
+
+		if (pos >= size) return false;
+		bool valid = true;
+		switch ((LogArgType)data[pos++])
+		{
+			case LogArgType::Int: valid = formatArg<int>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::UInt: valid = formatArg<unsigned int>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::Long: valid = formatArg<long>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::ULong: valid = formatArg<unsigned long>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::LongLong: valid = formatArg<long long>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::ULongLong: valid = formatArg<unsigned long long>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::Double: valid = formatArg<double>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::Pointer: valid = formatArg<const void*>(data, size, pos, text, spec, stars, star); break;
+			case LogArgType::String:
+			{
+				const char *str = (const char*)data+pos;
+				std::size_t length = strnlen(str, size-pos);
+				if (pos+length >= size) return false;
+				pos += length+1;
+				appendFormatted(text, spec, stars, star, str);
+				break;
+			}
+			case LogArgType::NullString:
+				appendFormatted(text, spec, stars, star, "(null)");
+				break;
+			default:
+				return false;
+		}
+		if (!valid) return false;
+	}
+	return true;
 }
\ No newline at end of file
@@ -27,7 +27,13 @@ SOFTWARE.
 #define APP_H
 
 #include "util/log.hpp"
-#include "util/blocked_vector.hpp"
+#include "util/atomic_blocked_queue.hpp"
+#include "util/util.hpp" // TimePoint_t
+
+#include <atomic>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 
 class AppState;
 extern AppState AppInstance;
@@ -41,15 +47,56 @@ class AppState
 public:
 	// Logging
 	struct LogEntry {
-		std::string log;
+		// Static format string if formatting was deferred until the message is first read
+		const char *format = nullptr;
+		// Packed arguments while deferred, formatted message once formatted
+		// Stored inline if short, else in the arena of the block of the entry
+		mutable ArenaBytes payload;
+		TimePoint_t timestamp;
 		enum LogCategory category = LDefault;
-		enum LogLevel level;
 		int context = 0; // #Target, #Controller, #Camera, etc.
+		enum LogLevel level;
+		enum State : uint8_t { Deferred, Formatting, Formatted };
+		mutable std::atomic<uint8_t> state = Deferred;
+
+		/**
+		 * Formatted message, formatted on first access and cached in the arena of its block (any thread)
+		 */
+		std::string_view text(ByteArena &arena) const;
 	};
-	BlockedQueue<LogEntry, 1024*16> logEntries;
+	// Trivially destructible, so that culled blocks are freed without visiting each entry
+	static_assert(std::is_trivially_destructible_v<LogEntry>);
+	// Around 64 bytes of arena per entry, which suffices for most messages
+	AtomicBlockedQueue<LogEntry, 1024*16, 1024*1024> logEntries; // Written by any thread without locking
+
+	/**
+	 * Limits of logs kept in memory, applied in the background in whole blocks of logEntries, 0 to disable
+	 * Only to be changed before StartLogMaintenance
+	 */
+	struct LogRetention
+	{
+		std::size_t maxEntries = 1000000;
+		std::size_t maxBytes = 256*1024*1024;
+		float maxAgeS = 0;
+	};
+	LogRetention logRetention;
+
+	/**
+	 * Start background thread applying logRetention and deleting culled logs
+	 */
+	void StartLogMaintenance();
+
+	/**
+	 * Cull oldest blocks of logs exceeding logRetention, returns number of entries culled
+	 */
+	std::size_t ApplyLogRetention();
 
 	void SignalQuitApp();
 	void SignalInterfaceClosed();
+
+private:
+	// Declared last so that it is joined before the logs are destroyed
+	std::jthread logMaintenance;
 };
 
 #endif // APP_H
\ No newline at end of file
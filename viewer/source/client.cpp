@@ -30,12 +30,16 @@ SOFTWARE.
 #include "ui/shared.hpp" // Signals
 
 #include "io/vrpn.hpp" // Outputting data over VRPN
+#include "io/clock.hpp"
 
 #include "util/log.hpp"
 #include "util/eigenutil.hpp"
 #include "util/util.hpp" // printBuffer, TimePoint_t
 
 #include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 
 #include "nlohmann/json.hpp"
 using json = nlohmann::json;
@@ -49,67 +53,142 @@ using json = nlohmann::json;
 
 /* Functions */
 
-static void ReceivingThread(std::stop_token stop_token, ClientState *state);
-static void parseConfigFile(std::string path, Config *config);
+static const char *ConfigPath = "config/config.json";
+
+static bool parseConfigFile(std::string path, Config *config);
 
 bool ClientInit(ClientState &state)
 {
-	parseConfigFile("config/config.json", &state.config);
+	parseConfigFile(ConfigPath, &state.config);
 
-	state.protocolThread = new std::jthread(ReceivingThread, &state);
+	// Needed to convert timestamps of received packets
+	GetClockSync().start();
 
 	SetupIO(state);
 
+	state.configWatcher = std::make_unique<ConfigWatcher>(ConfigPath, [&state](){ ReloadConfig(state); });
+
 	return true;
 }
 
 void ClientExit(ClientState &state)
 {
-	// Join coprocessing thread
-	delete state.protocolThread;
-	state.protocolThread = NULL;
+	// Reloads take io.mutex, so stop before
+	state.configWatcher = nullptr;
 
+	// Joins all receiving threads
 	ResetIO(state);
+
+	GetClockSync().stop();
 }
 
-static void ReceivingThread(std::stop_token stop_token, ClientState *state)
+static bool parseConfigFile(std::string path, Config *config)
 {
-	int it = 0;
-	
-	while (!stop_token.stop_requested())
+	// Read JSON config file
+	std::ifstream fs(path);
+	if (!fs.is_open()) return false;
+	json cfg = json::parse(fs, nullptr, false);
+	if (cfg.is_discarded())
 	{
-		it++;
+		LOG(LDefault, LError, "Failed to parse config file '%s'!", path.c_str());
+		return false;
+	}
 
-		{
-			auto io_lock = std::unique_lock(state->io.mutex);
-			for (auto &tracker : state->io.vrpn_trackers)
+	if (cfg.contains("vrpn_trackers") && cfg["vrpn_trackers"].is_array())
+	{
+		auto &vrpn_trackers = cfg["vrpn_trackers"];
+		for (auto &vrpn_tracker : vrpn_trackers)
+		{ // Either just the path, or an object with additional options
+			TrackerConfig tracker;
+			if (vrpn_tracker.is_string())
+				tracker.path = vrpn_tracker.get<std::string>();
+			else if (vrpn_tracker.is_object() && vrpn_tracker.contains("path") && vrpn_tracker["path"].is_string())
 			{
-				if (tracker.remote)
-					tracker.remote->mainloop();
+				tracker.path = vrpn_tracker["path"].get<std::string>();
+				if (vrpn_tracker.contains("lookahead_ms") && vrpn_tracker["lookahead_ms"].is_number())
+					tracker.lookaheadMS = vrpn_tracker["lookahead_ms"].get<float>();
 			}
-			state->io.vrpn_local->mainloop();
+			else continue;
+			config->vrpn_trackers.push_back(std::move(tracker));
 		}
-
-		std::this_thread::sleep_for(std::chrono::microseconds(500));
 	}
+	if (cfg.contains("vrpn_receive_threads") && cfg["vrpn_receive_threads"].is_number_integer())
+		config->vrpn_receive_threads = cfg["vrpn_receive_threads"].get<int>();
+	if (cfg.contains("vrpn_clock") && cfg["vrpn_clock"].is_string())
+		config->vrpn_clock = cfg["vrpn_clock"].get<std::string>();
+	if (cfg.contains("shared_memory") && cfg["shared_memory"].is_string())
+		config->shared_memory = cfg["shared_memory"].get<std::string>();
+
+	// TODO: Configure other integrations here as well
+
+	return true;
 }
 
-static void parseConfigFile(std::string path, Config *config)
+void ReloadConfig(ClientState &state)
 {
-	// Read JSON config file
-	std::ifstream fs(path);
-	if (!fs.is_open()) return;
-	json cfg;
-	fs >> cfg;
+	Config config;
+	if (!parseConfigFile(ConfigPath, &config))
+		return; // Keep running with previous config, e.g. while a file is half-written
 
-	if (cfg.contains("vrpn_trackers") && cfg["vrpn_trackers"].is_array())
+	auto io_lock = std::unique_lock(state.io.mutex);
+
+	// Trackers listed in the new config, in order, ignoring duplicates
+	std::unordered_map<std::string, const TrackerConfig*> configured;
+	for (auto &trkConfig : config.vrpn_trackers)
+		configured.emplace(trkConfig.path, &trkConfig);
+
+	// Drop trackers no longer configured, update options of those that stay
+	int removed = 0, added = 0;
+	for (auto trk = state.io.vrpn_trackers.begin(); trk != state.io.vrpn_trackers.end();)
 	{
-		auto &vrpn_trackers = cfg["vrpn_trackers"];
-		for (auto &vrpn_tracker : vrpn_trackers)
-			config->vrpn_trackers.push_back(vrpn_tracker.get<std::string>());
+		if (trk->replay)
+		{
+			trk++;
+			continue;
+		}
+		auto cfg = configured.find(trk->path);
+		if (cfg != configured.end())
+		{ // Keep tracker and its connection as is
+			trk->configured = true;
+			trk->lookaheadMS = cfg->second->lookaheadMS; // Published below
+			configured.erase(cfg);
+			trk++;
+		}
+		else if (trk->configured)
+		{
+			trk = RemoveTracker(state, trk);
+			removed++;
+		}
+		else trk++; // Added manually, not managed by config
 	}
 
-	// TODO: Configure other integrations here as well
+	// Connect newly configured trackers
+	for (auto &trkConfig : config.vrpn_trackers)
+	{
+		if (!configured.contains(trkConfig.path)) continue;
+		configured.erase(trkConfig.path);
+		auto &tracker = AddTracker(state, trkConfig.path, trkConfig.lookaheadMS);
+		tracker.configured = true;
+		ConnectTracker(state, tracker);
+		added++;
+	}
+
+	if (config.vrpn_receive_threads != state.config.vrpn_receive_threads)
+		LOG(LDefault, LWarn, "Changed number of receive threads only applies after a restart!");
+	if (config.vrpn_clock != state.config.vrpn_clock)
+		LOG(LDefault, LInfo, "Changed clock device only applies to new connections!");
+
+	if (config.shared_memory != state.config.shared_memory)
+	{
+		if (config.shared_memory.empty())
+			StopSharedMemory(state);
+		else
+			StartSharedMemory(state, config.shared_memory);
+	}
+
+	state.config = std::move(config);
+	PublishTrackers(state);
+	LOG(LDefault, LInfo, "Reloaded config, added %d and removed %d trackers!", added, removed);
 }
 
 
@@ -121,26 +200,269 @@ void SetupIO(ClientState &state)
 {
 	auto io_lock = std::unique_lock(state.io.mutex);
 
+	// Connects trackers in the background, waits for io.mutex to be released
+	state.io.connections = std::make_unique<ConnectionManager>(state);
+
+	// Setup fixed pool of receiving threads, connections are balanced across them
+	int workers = state.config.vrpn_receive_threads;
+	if (workers <= 0)
+		workers = std::clamp<int>(std::thread::hardware_concurrency()/2, 1, 8);
+	for (int i = 0; i < workers; i++)
+		state.io.vrpn_workers.emplace_back(i);
+
 	// Try connecting to a local VRPN server, just to tell if one is there
 	std::string connectionName = "localhost:" + std::to_string(vrpn_DEFAULT_LISTEN_PORT_NO);
-	state.io.vrpn_local = opaque_ptr<vrpn_Connection>(vrpn_get_connection_by_name(connectionName.c_str()));
+	state.io.vrpn_receivers.emplace_back(opaque_ptr<vrpn_Connection>(vrpn_get_connection_by_name(connectionName.c_str())),
+		state.io.vrpn_workers.front());
+	state.io.vrpn_local = &state.io.vrpn_receivers.back();
 
 	// Load all configured VRPN trackers
-	for (auto &trkPath : state.config.vrpn_trackers)
+	for (auto &trkConfig : state.config.vrpn_trackers)
 	{
-		// Add to list first so pointers stay intact
-		state.io.vrpn_trackers.emplace_back(trkPath);
-		state.io.vrpn_trackers.back().connect();
+		auto &tracker = AddTracker(state, trkConfig.path, trkConfig.lookaheadMS);
+		tracker.configured = true;
+		ConnectTracker(state, tracker);
 	}
 
+	if (!state.config.shared_memory.empty())
+		StartSharedMemory(state, state.config.shared_memory);
+
 	// TODO: Setup other integrations here as well
 }
 
 void ResetIO(ClientState &state)
 {
+	// Stop connecting first, manager thread locks io.mutex itself
+	if (state.io.connections)
+		state.io.connections->stop();
 	auto io_lock = std::unique_lock(state.io.mutex);
+	StopCapture(state);
+	StopReplay(state);
+	StopSharedMemory(state);
+	for (auto &tracker : state.io.vrpn_trackers)
+		DisconnectTracker(state, tracker);
 	state.io.vrpn_trackers.clear();
+	PublishTrackers(state);
+	state.io.connections = nullptr;
 	state.io.vrpn_local = nullptr;
+	state.io.vrpn_receivers.clear();
+	state.io.vrpn_workers.clear();
 
 	// TODO: Clean up other integrations here as well
-}
\ No newline at end of file
+}
+
+static int workerLoad(const vrpn_Worker &worker)
+{ // Connections with trackers share the time a worker spends waiting for packets, idle ones barely matter
+	// Receivers of workers are only modified with io.mutex locked, so no need to lock workers
+	return std::count_if(worker.receivers.begin(), worker.receivers.end(),
+		[](auto *receiver){ return !receiver->trackers.empty(); });
+}
+
+static bool lessLoaded(const vrpn_Worker &a, const vrpn_Worker &b)
+{
+	int loadA = workerLoad(a), loadB = workerLoad(b);
+	return loadA < loadB || (loadA == loadB && a.receivers.size() < b.receivers.size());
+}
+
+static vrpn_Worker &leastLoadedWorker(ClientState &state)
+{
+	return *std::min_element(state.io.vrpn_workers.begin(), state.io.vrpn_workers.end(), lessLoaded);
+}
+
+vrpn_Tracker_Wrapper &AddTracker(ClientState &state, std::string path, float lookaheadMS)
+{
+	SlotHandle handle = state.io.vrpn_trackers.emplace(std::move(path), lookaheadMS);
+	vrpn_Tracker_Wrapper &tracker = *state.io.vrpn_trackers.get(handle);
+	tracker.handle = handle;
+	if (state.io.publisher)
+		state.io.publisher->setTracker(handle.index, tracker.id, tracker.path);
+	PublishTrackers(state);
+	return tracker;
+}
+
+SlotMap<vrpn_Tracker_Wrapper>::iterator RemoveTracker(ClientState &state, SlotMap<vrpn_Tracker_Wrapper>::iterator tracker)
+{
+	DisconnectTracker(state, *tracker);
+	if (state.io.publisher)
+		state.io.publisher->clearTracker(tracker.handle().index);
+	auto next = state.io.vrpn_trackers.erase(tracker);
+	PublishTrackers(state);
+	return next;
+}
+
+void ConnectTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker)
+{
+	if (tracker.replay) return;
+	if (tracker.receiver)
+		DetachTracker(state, tracker);
+	// Connection is established in the background
+	state.io.connections->request(tracker);
+}
+
+void AttachTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker, opaque_ptr<vrpn_Connection> &&connection)
+{
+	auto receiver = std::find_if(state.io.vrpn_receivers.begin(), state.io.vrpn_receivers.end(),
+		[&](auto &rcv){ return rcv.connection.get() == connection.get(); });
+	if (receiver == state.io.vrpn_receivers.end())
+	{
+		state.io.vrpn_receivers.emplace_back(std::move(connection), leastLoadedWorker(state));
+		receiver = std::prev(state.io.vrpn_receivers.end());
+		auto host = tracker.path.find('@');
+		if (!state.config.vrpn_clock.empty() && host != std::string::npos)
+			receiver->syncClock(state.config.vrpn_clock + tracker.path.substr(host));
+	}
+	receiver->attach(tracker);
+	if (state.io.capture)
+		state.io.capture->addTracker(tracker.id, tracker.path);
+
+	RebalanceReceivers(state);
+}
+
+void DetachTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker)
+{
+	vrpn_Receiver *receiver = tracker.receiver;
+	if (!receiver) return;
+	receiver->detach(tracker);
+
+	if (receiver->trackers.empty() && receiver != state.io.vrpn_local)
+	{ // Close unused connections
+		state.io.vrpn_receivers.remove_if([&](auto &rcv){ return &rcv == receiver; });
+	}
+
+	RebalanceReceivers(state);
+}
+
+void PublishTrackers(ClientState &state)
+{
+	auto snapshot = std::make_shared<TrackerSnapshot>();
+	snapshot->trackers.reserve(state.io.vrpn_trackers.size());
+	for (auto &tracker : state.io.vrpn_trackers)
+	{
+		snapshot->index[tracker.handle] = snapshot->trackers.size();
+		snapshot->trackers.push_back({ tracker.handle, tracker.id, tracker.path, tracker.lookaheadMS, tracker.replay, tracker.stream });
+	}
+	auto lock = std::unique_lock(state.io.snapshotMutex);
+	state.io.snapshot = std::move(snapshot);
+}
+
+std::shared_ptr<const TrackerSnapshot> GetTrackers(ClientState &state)
+{
+	auto lock = std::unique_lock(state.io.snapshotMutex);
+	return state.io.snapshot;
+}
+
+void DisconnectTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker)
+{
+	if (state.io.connections)
+		state.io.connections->cancel(tracker);
+	DetachTracker(state, tracker);
+}
+
+void RebalanceReceivers(ClientState &state)
+{ // Spread connections with trackers evenly, so that as few as possible share the select time of a worker
+	if (state.io.vrpn_workers.size() < 2) return;
+	while (true)
+	{
+		auto [min, max] = std::minmax_element(state.io.vrpn_workers.begin(), state.io.vrpn_workers.end(),
+			[](auto &a, auto &b){ return workerLoad(a) < workerLoad(b); });
+		if (workerLoad(*max) - workerLoad(*min) < 2) break;
+		auto move = std::find_if(max->receivers.begin(), max->receivers.end(),
+			[](auto *receiver){ return !receiver->trackers.empty(); });
+		LOG(LIO, LDebug, "Moving connection with %d trackers from receive thread %d to %d!",
+			(int)(*move)->trackers.size(), max->index, min->index);
+		min->adopt(**move);
+	}
+}
+static void waitForDelivery(ClientState &state)
+{ // Once each thread delivering poses has been locked, none can still be using a consumer that was just deactivated
+	for (auto &worker : state.io.vrpn_workers)
+		worker.acquire();
+	if (state.io.replay)
+		state.io.replay->acquire();
+}
+
+bool StartCapture(ClientState &state, const std::string &path)
+{
+	std::error_code error;
+	if (state.io.replay && std::filesystem::equivalent(path, state.io.replay->path(), error))
+	{ // Compares by inode, so different paths to the same file are caught too
+		LOG(LIO, LError, "Cannot record into '%s' while it is being replayed!", path.c_str());
+		return false;
+	}
+	StopCapture(state);
+	auto capture = std::make_unique<CaptureWriter>();
+	if (!capture->open(path))
+		return false;
+	for (auto &tracker : state.io.vrpn_trackers)
+		capture->addTracker(tracker.id, tracker.path);
+	state.io.capture = std::move(capture);
+	SetActiveCapture(state.io.capture.get());
+	return true;
+}
+
+void StopCapture(ClientState &state)
+{
+	if (!state.io.capture) return;
+	SetActiveCapture(nullptr);
+	// Neither receiving threads nor the replay thread can still be writing to the capture afterwards
+	waitForDelivery(state);
+	state.io.capture = nullptr;
+}
+
+bool StartReplay(ClientState &state, const std::string &path)
+{
+	StopReplay(state);
+	auto replay = std::make_unique<CaptureReplay>();
+	if (!replay->open(path))
+		return false;
+	// Replayed trackers are fed just like connected trackers, but by the replay thread
+	std::unordered_map<uint32_t, vrpn_Tracker_Wrapper*> targets;
+	for (auto &captured : replay->trackers())
+	{
+		auto &tracker = AddTracker(state, std::string(captured.path, strnlen(captured.path, sizeof(captured.path))));
+		tracker.replay = true;
+		targets[captured.id] = &tracker;
+		if (state.io.capture)
+			state.io.capture->addTracker(tracker.id, tracker.path);
+	}
+	PublishTrackers(state);
+	replay->start(std::move(targets));
+	state.io.replay = std::move(replay);
+	LOG(LIO, LInfo, "Started replay of '%s'!", path.c_str());
+	return true;
+}
+
+void StopReplay(ClientState &state)
+{
+	if (!state.io.replay) return;
+	state.io.replay = nullptr;
+	state.io.vrpn_trackers.remove_if([&](auto &tracker)
+	{
+		if (tracker.replay && state.io.publisher)
+			state.io.publisher->clearTracker(tracker.handle.index);
+		return tracker.replay;
+	});
+	PublishTrackers(state);
+}
+
+bool StartSharedMemory(ClientState &state, const std::string &name)
+{
+	StopSharedMemory(state);
+	auto publisher = std::make_unique<ShmPublisher>();
+	if (!publisher->open(name))
+		return false;
+	for (auto &tracker : state.io.vrpn_trackers)
+		publisher->setTracker(tracker.handle.index, tracker.id, tracker.path);
+	state.io.publisher = std::move(publisher);
+	SetActivePublisher(state.io.publisher.get());
+	return true;
+}
+
+void StopSharedMemory(ClientState &state)
+{
+	if (!state.io.publisher) return;
+	SetActivePublisher(nullptr);
+	// Neither receiving threads nor the replay thread can still be writing to the segment afterwards
+	waitForDelivery(state);
+	state.io.publisher = nullptr;
+}
@@ -27,10 +27,17 @@ SOFTWARE.
 #define CLIENT_H
 
 #include "io/vrpn.hpp"
+#include "io/connection.hpp"
+#include "io/capture.hpp"
+#include "io/replay.hpp"
+#include "io/shm_publisher.hpp"
+#include "io/config_watcher.hpp"
 
 #include <thread>
 #include <mutex>
 #include <list>
+#include <memory>
+#include <unordered_map>
 
 struct ClientState;
 
@@ -38,24 +45,69 @@ extern ClientState StateInstance;
 static inline ClientState &GetState() { return StateInstance; }
 
 
+struct TrackerConfig
+{
+	std::string path;
+	float lookaheadMS = 0.0f; // Time to predict poses ahead for display
+};
+
 struct Config
 {
-	std::vector<std::string> vrpn_trackers;
+	std::vector<TrackerConfig> vrpn_trackers;
+	std::string vrpn_clock; // Name of VRPN clock device on remote servers used to sync clocks, empty to disable
+	int vrpn_receive_threads = 0; // Number of threads servicing VRPN connections, 0 to choose automatically
+	std::string shared_memory; // Name of shared memory segment to republish poses into, empty to disable
+};
+
+/**
+ * Immutable snapshot of the tracker list for the interface to iterate without locking io.mutex
+ * Republished whenever trackers are added, removed or their options change
+ */
+struct TrackerSnapshot
+{
+	struct Tracker
+	{
+		SlotHandle handle;
+		uint32_t id;
+		std::string path;
+		float lookaheadMS;
+		bool replay;
+		std::shared_ptr<TrackerStream> stream; // Kept alive even if the tracker is removed meanwhile
+	};
+	std::vector<Tracker> trackers; // In order of the registry
+	std::unordered_map<SlotHandle, std::size_t> index;
+
+	const Tracker *find(SlotHandle handle) const
+	{
+		auto it = index.find(handle);
+		return it != index.end()? &trackers[it->second] : nullptr;
+	}
 };
 
 struct ClientState
 {
 	Config config = {};
-
-	std::jthread *protocolThread = NULL;
+	std::unique_ptr<ConfigWatcher> configWatcher; // Reloads config on changes
 
 	struct
 	{
 		std::mutex mutex;
 
 		// VRPN IO
-		opaque_ptr<vrpn_Connection> vrpn_local;
-		std::list<vrpn_Tracker_Wrapper> vrpn_trackers;
+		std::list<vrpn_Worker> vrpn_workers; // Fixed pool of receiving threads, outlives receivers
+		std::list<vrpn_Receiver> vrpn_receivers; // One per connection, assigned to a worker
+		vrpn_Receiver *vrpn_local = nullptr;
+		SlotMap<vrpn_Tracker_Wrapper> vrpn_trackers; // Registry with stable handles
+		std::mutex snapshotMutex; // Only protects snapshot itself, never held for long
+		std::shared_ptr<const TrackerSnapshot> snapshot = std::make_shared<TrackerSnapshot>();
+		std::unique_ptr<ConnectionManager> connections;
+
+		// Recording
+		std::unique_ptr<CaptureWriter> capture;
+		std::unique_ptr<CaptureReplay> replay; // Feeds trackers marked as replay
+
+		// Local consumers
+		std::unique_ptr<ShmPublisher> publisher;
 	} io;
 };
 
@@ -67,4 +119,33 @@ void ClientExit(ClientState &state);
 void SetupIO(ClientState &state);
 void ResetIO(ClientState &state);
 
+/**
+ * Re-read config file and apply differences to the running client
+ * Only trackers added or removed in the config are connected or dropped, all others stay untouched
+ */
+void ReloadConfig(ClientState &state);
+
+// Expect io.mutex to be locked
+vrpn_Tracker_Wrapper &AddTracker(ClientState &state, std::string path, float lookaheadMS = 0.0f);
+SlotMap<vrpn_Tracker_Wrapper>::iterator RemoveTracker(ClientState &state, SlotMap<vrpn_Tracker_Wrapper>::iterator tracker);
+void ConnectTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker); // Only requests connection from ConnectionManager
+void DisconnectTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker);
+void AttachTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker, opaque_ptr<vrpn_Connection> &&connection);
+void DetachTracker(ClientState &state, vrpn_Tracker_Wrapper &tracker); // Keeps pending connection requests
+void RebalanceReceivers(ClientState &state);
+void PublishTrackers(ClientState &state); // Publish a new tracker snapshot after changes to trackers or their options
+
+/**
+ * Latest tracker snapshot, for any thread without locking io.mutex
+ */
+std::shared_ptr<const TrackerSnapshot> GetTrackers(ClientState &state);
+
+// Expect io.mutex to be locked
+bool StartCapture(ClientState &state, const std::string &path);
+void StopCapture(ClientState &state);
+bool StartReplay(ClientState &state, const std::string &path);
+void StopReplay(ClientState &state);
+bool StartSharedMemory(ClientState &state, const std::string &name);
+void StopSharedMemory(ClientState &state);
+
 #endif // CLIENT_H
\ No newline at end of file
@@ -0,0 +1,136 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "headless.hpp"
+#include "client.hpp"
+
+#include "io/packet_trace.hpp"
+
+#include "util/util.hpp" // TimePoint_t, dtUS
+
+#include <cstdio>
+#include <unordered_map>
+#include <algorithm>
+
+/**
+ * Headless run mode, e.g. for relay or monitor nodes and benchmarks
+ */
+
+struct LatencySummary
+{
+	uint64_t count = 0;
+	double sumUS = 0, maxUS = 0;
+};
+
+static void printSummary(ClientState &state, float elapsedS, float intervalS,
+	std::unordered_map<SlotHandle, unsigned int> &lastPackets,
+	std::unordered_map<uint32_t, LatencySummary> &latencies)
+{
+	auto io_lock = std::unique_lock(state.io.mutex);
+
+	unsigned int totalPackets = 0;
+	LatencySummary total;
+	for (auto &latency : latencies)
+	{
+		total.count += latency.second.count;
+		total.sumUS += latency.second.sumUS;
+		total.maxUS = std::max(total.maxUS, latency.second.maxUS);
+	}
+	for (auto &tracker : state.io.vrpn_trackers)
+	{
+		unsigned int packets = tracker.published.read().packets;
+		totalPackets += packets - lastPackets[tracker.handle];
+	}
+
+	printf("[%.1fs] %d trackers, %.1f packets/s", elapsedS, (int)state.io.vrpn_trackers.size(), totalPackets / intervalS);
+	if (total.count > 0)
+		printf(", latency avg %.2fms max %.2fms", total.sumUS / total.count / 1000, total.maxUS / 1000);
+	if (state.io.capture)
+		printf(", captured %lu samples (%lu dropped)", (unsigned long)state.io.capture->records(), (unsigned long)state.io.capture->dropped());
+	if (state.io.replay)
+		printf(", replayed %lu samples", (unsigned long)state.io.replay->samples());
+	printf("\n");
+
+	for (auto &tracker : state.io.vrpn_trackers)
+	{
+		auto published = tracker.published.read();
+		unsigned int packets = published.packets - lastPackets[tracker.handle];
+		lastPackets[tracker.handle] = published.packets;
+		printf("  %s: %.1f packets/s, %d sensors", tracker.path.c_str(), packets / intervalS, tracker.sensors.sensors());
+		auto latency = latencies.find(tracker.id);
+		if (latency != latencies.end() && latency->second.count > 0)
+			printf(", latency avg %.2fms max %.2fms", latency->second.sumUS / latency->second.count / 1000, latency->second.maxUS / 1000);
+		else if (packets == 0)
+			printf(", %s", tracker.replay? "replay idle" : TrackerStatusName(tracker.status.load()));
+		auto stats = tracker.stats.read();
+		if (stats.updated != TimePoint_t())
+			printf(", p99 %.2fms, jitter %.3fms, %u gaps, %u dropouts%s", stats.latencyP99MS, stats.jitterMS, stats.gaps, stats.dropouts, stats.stalled? " (stalled)" : "");
+		printf("\n");
+	}
+	for (auto &worker : state.io.vrpn_workers)
+	{
+		printf("  Receive thread %d: %d connections (%d active), %d trackers, %.0f packets/s\n", worker.index,
+			(int)worker.receivers.size(), worker.activeCount.load(), worker.trackerCount.load(), worker.packetRate.load());
+	}
+	fflush(stdout);
+	latencies.clear();
+}
+
+void RunHeadless(ClientState &state, const HeadlessOptions &options, const std::atomic<bool> &quit)
+{
+	printf("Running headless, printing summaries every %.1fs\n", options.summaryInterval);
+	fflush(stdout);
+
+	TimePoint_t start = sclock::now(), lastSummary = start;
+	std::unordered_map<SlotHandle, unsigned int> lastPackets;
+	std::unordered_map<uint32_t, LatencySummary> latencies;
+	// Latency of every single packet is available from the packet trace
+	PacketTrace::Cursors cursors;
+	std::vector<PacketRecord> records;
+	while (!quit.load())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		TimePoint_t now = sclock::now();
+
+		records.clear();
+		GetPacketTrace().collect(cursors, records);
+		for (auto &record : records)
+		{
+			auto &latency = latencies[record.tracker];
+			double latencyUS = dtUS(record.timestamp, record.received);
+			latency.count++;
+			latency.sumUS += latencyUS;
+			latency.maxUS = std::max(latency.maxUS, latencyUS);
+		}
+
+		if (dtUS(lastSummary, now) >= options.summaryInterval*1000000)
+		{
+			printSummary(state, dtUS(start, now)/1000000.0f, dtUS(lastSummary, now)/1000000.0f, lastPackets, latencies);
+			lastSummary = now;
+		}
+		if (options.duration > 0 && dtUS(start, now) >= options.duration*1000000)
+			break;
+	}
+}
@@ -0,0 +1,452 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "capture.hpp"
+
+#include "io/clock.hpp"
+
+#include "util/log.hpp"
+
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#ifdef __unix__
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ * Recording of pose samples into memory-mapped capture files
+ */
+
+static std::atomic<CaptureWriter*> ActiveCapture = nullptr;
+CaptureWriter *GetActiveCapture() { return ActiveCapture.load(std::memory_order_acquire); }
+void SetActiveCapture(CaptureWriter *capture) { ActiveCapture.store(capture, std::memory_order_release); }
+
+// Interval in which the background thread checks for completed chunks and updates the header
+static const long maintainIntervalMS = 50;
+
+template<typename T>
+static inline void publish(T &field, T value)
+{ // Fields read by other processes while the file is being written
+	std::atomic_ref<T>(field).store(value, std::memory_order_release);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+	close();
+}
+
+#ifdef __unix__
+
+bool CaptureWriter::open(const std::string &path)
+{
+	close();
+	// Replace instead of truncating an existing file, which would pull the file from under readers that mapped it
+	if (::unlink(path.c_str()) != 0 && errno != ENOENT)
+	{
+		LOG(LIO, LError, "Failed to replace capture file '%s': %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (m_fd < 0)
+	{
+		LOG(LIO, LError, "Failed to create capture file '%s': %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	if (ftruncate(m_fd, Capture::HeaderSize) != 0)
+	{
+		LOG(LIO, LError, "Failed to allocate capture file '%s': %s", path.c_str(), strerror(errno));
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	void *map = mmap(nullptr, Capture::HeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (map == MAP_FAILED)
+	{
+		LOG(LIO, LError, "Failed to map capture file '%s': %s", path.c_str(), strerror(errno));
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	m_path = path;
+	m_header = (CaptureHeader*)map;
+	std::memcpy(m_header->magic, Capture::Magic, sizeof(Capture::Magic));
+	m_header->version = Capture::Version;
+	m_header->headerSize = Capture::HeaderSize;
+	m_header->chunkSize = Capture::ChunkSize;
+	m_header->recordSize = sizeof(CaptureRecord);
+	m_header->recordsPerChunk = Capture::RecordsPerChunk;
+	m_header->maxTrackers = Capture::MaxTrackers;
+	m_header->startUS = GetClockSync().toSystemUS(sclock::now());
+
+	for (auto &chunk : m_chunks)
+		chunk.done = 0;
+	m_claimed = 0;
+	m_dropped = 0;
+	m_sealedChunks = 0;
+	if (!mapChunks(ChunksAhead))
+	{
+		close();
+		return false;
+	}
+
+	m_thread = std::jthread([this](std::stop_token stop_token){ run(stop_token); });
+	LOG(LIO, LInfo, "Started capture into '%s'!", path.c_str());
+	return true;
+}
+
+void CaptureWriter::close()
+{
+	if (m_fd < 0) return;
+	// Expects no more writes, so all claimed records are complete
+	m_thread = {};
+
+	uint64_t claimed = m_claimed.load();
+	uint32_t used = publishChunkCount();
+	for (uint32_t c = m_sealedChunks; c < m_mappedChunks.load(); c++)
+	{
+		if (c < used)
+			sealChunk(c, std::min<uint64_t>(claimed - (uint64_t)c*Capture::RecordsPerChunk, Capture::RecordsPerChunk));
+		else
+			munmap(m_chunks[c].map.exchange(nullptr), Capture::ChunkSize);
+	}
+	// Cut off chunks mapped ahead but not used, which readers never knew about
+	if (ftruncate(m_fd, Capture::HeaderSize + (uint64_t)used*Capture::ChunkSize) != 0)
+		LOG(LIO, LWarn, "Failed to truncate capture file '%s': %s", m_path.c_str(), strerror(errno));
+	publish<uint64_t>(m_header->records, records());
+	publish<uint64_t>(m_header->dropped, dropped());
+	publish(m_header->finished, 1u);
+	msync(m_header, Capture::HeaderSize, MS_SYNC);
+	munmap(m_header, Capture::HeaderSize);
+	m_header = nullptr;
+	::close(m_fd);
+	m_fd = -1;
+	m_mappedChunks = 0;
+	LOG(LIO, LInfo, "Finished capture into '%s' with %lu samples (%lu dropped)!",
+		m_path.c_str(), (unsigned long)records(), (unsigned long)dropped());
+}
+
+bool CaptureWriter::mapChunks(uint32_t count)
+{
+	uint32_t mapped = m_mappedChunks.load(std::memory_order_relaxed);
+	count = std::min<uint32_t>(count, MaxChunks);
+	if (count <= mapped) return true;
+	// Extend file first, reserving the space so writing through the mapping cannot fail
+	uint64_t size = Capture::HeaderSize + (uint64_t)count*Capture::ChunkSize;
+	int error = posix_fallocate(m_fd, 0, size);
+	if (error != 0 && ftruncate(m_fd, size) != 0)
+	{
+		LOG(LIO, LError, "Failed to extend capture file '%s': %s", m_path.c_str(), strerror(error));
+		return false;
+	}
+	for (uint32_t c = mapped; c < count; c++)
+	{
+		void *map = mmap(nullptr, Capture::ChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd,
+			Capture::HeaderSize + (uint64_t)c*Capture::ChunkSize);
+		if (map == MAP_FAILED)
+		{
+			LOG(LIO, LError, "Failed to map chunk %d of capture file '%s': %s", c, m_path.c_str(), strerror(errno));
+			return false;
+		}
+		CaptureChunk *chunk = (CaptureChunk*)map;
+		chunk->magic = Capture::ChunkMagic;
+		chunk->index = c;
+		m_chunks[c].map.store((uint8_t*)map, std::memory_order_release);
+		m_mappedChunks.store(c+1, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+uint32_t CaptureWriter::publishChunkCount()
+{ // Chunks mapped ahead stay private to the writer until records are claimed in them, since they might still be cut off
+	uint64_t claimed = m_claimed.load(std::memory_order_relaxed);
+	uint32_t used = std::min<uint64_t>((claimed + Capture::RecordsPerChunk-1) / Capture::RecordsPerChunk,
+		m_mappedChunks.load(std::memory_order_relaxed));
+	publish(m_header->chunkCount, used);
+	return used;
+}
+
+void CaptureWriter::sealChunk(uint32_t c, uint32_t records)
+{
+	uint8_t *map = m_chunks[c].map.exchange(nullptr);
+	CaptureChunk *chunk = (CaptureChunk*)map;
+	CaptureRecord *recs = (CaptureRecord*)(map + sizeof(CaptureChunk));
+
+	// Build index block and find sensors of all trackers
+	uint32_t trackerCount = std::atomic_ref(m_header->trackerCount).load(std::memory_order_acquire);
+	CaptureTracker *trackers = (CaptureTracker*)((uint8_t*)m_header + sizeof(CaptureHeader));
+	std::unordered_map<uint32_t, uint32_t> sensors;
+	uint32_t valid = 0;
+	int64_t firstUS = std::numeric_limits<int64_t>::max(), lastUS = std::numeric_limits<int64_t>::min();
+	for (uint32_t i = 0; i < records; i++)
+	{
+		if (!(recs[i].flags & Capture::RecordValid)) continue;
+		valid++;
+		firstUS = std::min(firstUS, recs[i].receivedUS);
+		lastUS = std::max(lastUS, recs[i].receivedUS);
+		uint32_t &count = sensors[recs[i].tracker];
+		count = std::max<uint32_t>(count, recs[i].sensor+1);
+	}
+	for (uint32_t t = 0; t < trackerCount; t++)
+	{
+		auto it = sensors.find(trackers[t].id);
+		if (it != sensors.end() && it->second > trackers[t].sensors)
+			publish(trackers[t].sensors, it->second);
+	}
+	chunk->records = valid;
+	chunk->firstUS = valid? firstUS : 0;
+	chunk->lastUS = valid? lastUS : 0;
+	publish(chunk->flags, (uint32_t)Capture::ChunkSealed);
+
+	// Let the kernel write it back in its own time, no need to keep it mapped
+	munmap(map, Capture::ChunkSize);
+	m_sealedChunks = c+1;
+	publish(m_header->sealedChunks, m_sealedChunks);
+}
+
+void CaptureWriter::run(std::stop_token stop_token)
+{
+	std::unique_lock lock(m_threadMutex);
+	while (!stop_token.stop_requested())
+	{
+		uint32_t current = m_claimed.load(std::memory_order_relaxed) / Capture::RecordsPerChunk;
+		mapChunks(current + ChunksAhead);
+		publishChunkCount();
+
+		// Seal all chunks all records of which have been written
+		while (m_sealedChunks < m_mappedChunks.load(std::memory_order_relaxed)
+			&& m_chunks[m_sealedChunks].done.load(std::memory_order_acquire) == Capture::RecordsPerChunk)
+			sealChunk(m_sealedChunks, Capture::RecordsPerChunk);
+
+		publish<uint64_t>(m_header->records, records());
+		publish<uint64_t>(m_header->dropped, dropped());
+
+		m_threadWake.wait_for(lock, stop_token, std::chrono::milliseconds(maintainIntervalMS), [&]
+		{ // Woken up early by receiving threads starting a new chunk
+			return m_claimed.load(std::memory_order_relaxed) / Capture::RecordsPerChunk + ChunksAhead > m_mappedChunks.load(std::memory_order_relaxed);
+		});
+	}
+}
+
+
+CaptureReader::~CaptureReader()
+{
+	close();
+}
+
+bool CaptureReader::open(const std::string &path)
+{
+	close();
+	m_fd = ::open(path.c_str(), O_RDONLY);
+	if (m_fd < 0)
+	{
+		LOG(LIO, LError, "Failed to open capture file '%s': %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	void *map = mmap(nullptr, Capture::HeaderSize, PROT_READ, MAP_SHARED, m_fd, 0);
+	if (map == MAP_FAILED)
+	{
+		LOG(LIO, LError, "Failed to map capture file '%s': %s", path.c_str(), strerror(errno));
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	m_header = (const CaptureHeader*)map;
+	if (std::memcmp(m_header->magic, Capture::Magic, sizeof(Capture::Magic)) != 0 || m_header->version != Capture::Version
+		|| m_header->headerSize != Capture::HeaderSize || m_header->chunkSize != Capture::ChunkSize
+		|| m_header->recordSize != sizeof(CaptureRecord))
+	{
+		LOG(LIO, LError, "File '%s' is not a compatible capture file!", path.c_str());
+		close();
+		return false;
+	}
+	m_path = path;
+	return true;
+}
+
+void CaptureReader::close()
+{
+	for (auto &mapping : m_window)
+	{
+		if (mapping.map)
+			munmap(mapping.map, Capture::ChunkSize);
+		mapping = {};
+	}
+	if (m_header)
+		munmap((void*)m_header, Capture::HeaderSize);
+	m_header = nullptr;
+	if (m_fd >= 0)
+		::close(m_fd);
+	m_fd = -1;
+}
+
+uint32_t CaptureReader::chunkCount() const
+{
+	return std::atomic_ref(const_cast<uint32_t&>(m_header->chunkCount)).load(std::memory_order_acquire);
+}
+
+bool CaptureReader::finished() const
+{
+	return std::atomic_ref(const_cast<uint32_t&>(m_header->finished)).load(std::memory_order_acquire);
+}
+
+std::vector<CaptureTracker> CaptureReader::trackers() const
+{
+	uint32_t count = std::atomic_ref(const_cast<uint32_t&>(m_header->trackerCount)).load(std::memory_order_acquire);
+	const CaptureTracker *table = (const CaptureTracker*)((const uint8_t*)m_header + sizeof(CaptureHeader));
+	return std::vector<CaptureTracker>(table, table + std::min(count, Capture::MaxTrackers));
+}
+
+bool CaptureReader::readChunkInfo(uint32_t chunk, CaptureChunk &info) const
+{
+	if (chunk >= chunkCount()) return false;
+	off_t offset = Capture::HeaderSize + (uint64_t)chunk*Capture::ChunkSize;
+	if (pread(m_fd, &info, sizeof(info), offset) != sizeof(info)) return false;
+	return info.magic == Capture::ChunkMagic && info.index == chunk;
+}
+
+const CaptureRecord *CaptureReader::mapChunk(uint32_t chunk)
+{
+	m_uses++;
+	Mapping *evict = &m_window[0];
+	for (auto &mapping : m_window)
+	{
+		if (mapping.map && mapping.chunk == chunk)
+		{
+			mapping.lastUse = m_uses;
+			return (const CaptureRecord*)(mapping.map + sizeof(CaptureChunk));
+		}
+		if (mapping.lastUse < evict->lastUse)
+			evict = &mapping;
+	}
+	if (chunk >= chunkCount()) return nullptr;
+
+	off_t offset = Capture::HeaderSize + (uint64_t)chunk*Capture::ChunkSize;
+	void *map = mmap(nullptr, Capture::ChunkSize, PROT_READ, MAP_SHARED, m_fd, offset);
+	if (map == MAP_FAILED)
+	{
+		LOG(LIO, LError, "Failed to map chunk %d of capture file '%s': %s", chunk, m_path.c_str(), strerror(errno));
+		return nullptr;
+	}
+	madvise(map, Capture::ChunkSize, MADV_SEQUENTIAL);
+	// Have the kernel read ahead the next chunk
+	posix_fadvise(m_fd, offset + Capture::ChunkSize, Capture::ChunkSize, POSIX_FADV_WILLNEED);
+	if (evict->map)
+		munmap(evict->map, Capture::ChunkSize);
+	evict->chunk = chunk;
+	evict->map = (uint8_t*)map;
+	evict->lastUse = m_uses;
+	return (const CaptureRecord*)(evict->map + sizeof(CaptureChunk));
+}
+
+#else
+
+bool CaptureWriter::open(const std::string &path)
+{
+	LOG(LIO, LError, "Capturing is not yet supported on this platform!");
+	return false;
+}
+
+void CaptureWriter::close() {}
+bool CaptureWriter::mapChunks(uint32_t count) { return false; }
+uint32_t CaptureWriter::publishChunkCount() { return 0; }
+void CaptureWriter::sealChunk(uint32_t chunk, uint32_t records) {}
+void CaptureWriter::run(std::stop_token stop_token) {}
+
+CaptureReader::~CaptureReader() {}
+
+bool CaptureReader::open(const std::string &path)
+{
+	LOG(LIO, LError, "Replaying captures is not yet supported on this platform!");
+	return false;
+}
+
+void CaptureReader::close() {}
+uint32_t CaptureReader::chunkCount() const { return 0; }
+bool CaptureReader::finished() const { return true; }
+std::vector<CaptureTracker> CaptureReader::trackers() const { return {}; }
+bool CaptureReader::readChunkInfo(uint32_t chunk, CaptureChunk &info) const { return false; }
+const CaptureRecord *CaptureReader::mapChunk(uint32_t chunk) { return nullptr; }
+
+#endif
+
+void CaptureWriter::addTracker(uint32_t id, const std::string &path)
+{
+	if (!m_header) return;
+	uint32_t count = m_header->trackerCount;
+	CaptureTracker *trackers = (CaptureTracker*)((uint8_t*)m_header + sizeof(CaptureHeader));
+	for (uint32_t t = 0; t < count; t++)
+		if (trackers[t].id == id) return;
+	if (count >= Capture::MaxTrackers)
+	{
+		LOG(LIO, LWarn, "Exceeded maximum of %d trackers in capture file!", Capture::MaxTrackers);
+		return;
+	}
+	trackers[count].id = id;
+	trackers[count].sensors = 0;
+	std::strncpy(trackers[count].path, path.c_str(), sizeof(trackers[count].path)-1);
+	publish(m_header->trackerCount, count+1);
+}
+
+bool CaptureWriter::record(uint32_t tracker, int sensor, const Eigen::Vector3f &pos, const Eigen::Quaternionf &rot,
+	TimePoint_t timestamp, TimePoint_t received)
+{
+	uint64_t index = m_claimed.fetch_add(1, std::memory_order_relaxed);
+	uint64_t c = index / Capture::RecordsPerChunk;
+	if (c >= MaxChunks)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	Chunk &chunk = m_chunks[c];
+	uint8_t *map = chunk.map.load(std::memory_order_acquire);
+	if (map)
+	{ // Write directly into mapped file
+		CaptureRecord *rec = (CaptureRecord*)(map + sizeof(CaptureChunk)) + (index % Capture::RecordsPerChunk);
+		rec->tracker = tracker;
+		rec->sensor = sensor;
+		rec->timestampUS = GetClockSync().toSystemUS(timestamp);
+		rec->receivedUS = GetClockSync().toSystemUS(received);
+		rec->position[0] = pos.x();
+		rec->position[1] = pos.y();
+		rec->position[2] = pos.z();
+		rec->rotation[0] = rot.x();
+		rec->rotation[1] = rot.y();
+		rec->rotation[2] = rot.z();
+		rec->rotation[3] = rot.w();
+		publish<uint16_t>(rec->flags, Capture::RecordValid);
+	}
+	else
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+	// Count even if dropped, so the chunk can be sealed
+	chunk.done.fetch_add(1, std::memory_order_release);
+	if (index % Capture::RecordsPerChunk == 0)
+		m_threadWake.notify_one(); // Map next chunks ahead of time
+	return map != nullptr;
+}
@@ -0,0 +1,242 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "util/eigendef.hpp"
+#include "util/util.hpp" // TimePoint_t
+
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/*
+ * Capture file format, append-only and readable while being written
+ *
+ * [CaptureHeader + CaptureTracker table, padded to HeaderSize]
+ * [Chunk 0: CaptureChunk index block + CaptureRecord array, padded to ChunkSize]
+ * [Chunk 1: ...]
+ *
+ * Records are claimed in order of arrival, but may be completed out of order by different threads,
+ * so readers have to check Valid in the flags of each record of chunks that are not yet sealed
+ * Once all records of a chunk are completed, its index block is filled in and it is marked as sealed
+ * All times are in microseconds of the system clock, all values little-endian
+ */
+
+namespace Capture
+{
+	static const uint32_t Version = 1;
+	static const uint32_t HeaderSize = 1<<16;
+	static const uint32_t ChunkSize = 1<<22;
+	static const char Magic[8] = { 'A', 'S', 'T', 'R', 'C', 'A', 'P', 0 };
+	static const uint32_t ChunkMagic = 0x4B484341; // ACHK
+
+	enum RecordFlags : uint16_t
+	{
+		RecordValid = 1 << 0,
+	};
+	enum ChunkFlags : uint32_t
+	{
+		ChunkSealed = 1 << 0,
+	};
+}
+
+struct CaptureRecord
+{
+	uint32_t tracker; // CaptureTracker::id
+	uint16_t sensor;
+	uint16_t flags; // Capture::RecordFlags, written last
+	int64_t timestampUS, receivedUS;
+	float position[3];
+	float rotation[4]; // x, y, z, w
+};
+static_assert(sizeof(CaptureRecord) == 56);
+
+struct CaptureTracker
+{
+	uint32_t id;
+	uint32_t sensors; // Highest sensor id + 1 in sealed chunks
+	char path[120];
+};
+static_assert(sizeof(CaptureTracker) == 128);
+
+struct CaptureHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize, chunkSize, recordSize, recordsPerChunk;
+	uint32_t maxTrackers;
+	uint32_t trackerCount; // Entries in tracker table following the header, incremented after writing an entry
+	uint32_t chunkCount; // Chunks records have been written into, may lag behind by an interval of the writer
+	uint32_t sealedChunks; // Chunks before this are sealed
+	uint32_t finished; // Set once writer closed the file
+	int64_t startUS;
+	uint64_t records, dropped; // Updated periodically
+	uint8_t padding[56];
+};
+static_assert(sizeof(CaptureHeader) == 128);
+
+struct CaptureChunk
+{
+	uint32_t magic; // Capture::ChunkMagic
+	uint32_t index;
+	uint32_t flags; // Capture::ChunkFlags
+	uint32_t records; // Valid records, once sealed
+	int64_t firstUS, lastUS; // Range of receive times, once sealed
+	uint8_t padding[32];
+};
+static_assert(sizeof(CaptureChunk) == 64);
+
+namespace Capture
+{
+	static const uint32_t MaxTrackers = (HeaderSize - sizeof(CaptureHeader)) / sizeof(CaptureTracker);
+	static const uint32_t RecordsPerChunk = (ChunkSize - sizeof(CaptureChunk)) / sizeof(CaptureRecord);
+}
+
+/**
+ * Records pose samples into a capture file through memory mappings
+ * Receiving threads write records directly into mapped chunks without locking or blocking,
+ * a background thread extends and maps the file ahead of them, and seals and unmaps completed chunks
+ * Samples are dropped if they arrive faster than chunks are mapped
+ */
+class CaptureWriter
+{
+public:
+	static const int MaxChunks = 1<<16;
+	static const int ChunksAhead = 2;
+
+	CaptureWriter() {}
+	~CaptureWriter();
+
+	bool open(const std::string &path);
+	void close();
+	bool isOpen() const { return m_fd >= 0; }
+	const std::string &path() const { return m_path; }
+
+	/**
+	 * Register a tracker in the file header, only from one thread at a time
+	 */
+	void addTracker(uint32_t id, const std::string &path);
+
+	/**
+	 * Record a pose sample, from any thread
+	 */
+	bool record(uint32_t tracker, int sensor, const Eigen::Vector3f &pos, const Eigen::Quaternionf &rot,
+		TimePoint_t timestamp, TimePoint_t received);
+
+	uint64_t records() const { return m_claimed.load(std::memory_order_relaxed) - m_dropped.load(std::memory_order_relaxed); }
+	uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+	uint64_t fileSize() const { return Capture::HeaderSize + (uint64_t)m_mappedChunks.load(std::memory_order_relaxed) * Capture::ChunkSize; }
+
+private:
+	struct Chunk
+	{
+		std::atomic<uint8_t*> map = nullptr;
+		std::atomic<uint32_t> done = 0;
+	};
+
+	std::string m_path;
+	int m_fd = -1;
+	CaptureHeader *m_header = nullptr;
+	std::array<Chunk, MaxChunks> m_chunks;
+	std::atomic<uint64_t> m_claimed = 0, m_dropped = 0;
+	std::atomic<uint32_t> m_mappedChunks = 0;
+	uint32_t m_sealedChunks = 0;
+
+	std::mutex m_threadMutex;
+	std::condition_variable_any m_threadWake;
+	std::jthread m_thread;
+
+	void run(std::stop_token stop_token);
+	bool mapChunks(uint32_t count);
+	uint32_t publishChunkCount();
+	void sealChunk(uint32_t chunk, uint32_t records);
+};
+
+/**
+ * Reads capture files through a small window of memory-mapped chunks, while they may still be written to
+ * Only the chunks currently being read are mapped, with the kernel reading ahead the following chunk
+ */
+class CaptureReader
+{
+public:
+	static const int WindowChunks = 2;
+
+	CaptureReader() {}
+	~CaptureReader();
+
+	bool open(const std::string &path);
+	void close();
+	bool isOpen() const { return m_fd >= 0; }
+	const std::string &path() const { return m_path; }
+
+	/**
+	 * Number of chunks currently in the file, and whether the writer has finished
+	 */
+	uint32_t chunkCount() const;
+	bool finished() const;
+
+	std::vector<CaptureTracker> trackers() const;
+
+	/**
+	 * Read index block of a chunk without mapping it
+	 */
+	bool readChunkInfo(uint32_t chunk, CaptureChunk &info) const;
+
+	/**
+	 * Map chunk into window, evicting the least recently used chunk
+	 * Returned records are valid until the chunk is evicted, and have to be checked for Capture::RecordValid
+	 */
+	const CaptureRecord *mapChunk(uint32_t chunk);
+
+private:
+	struct Mapping
+	{
+		uint32_t chunk = 0;
+		uint8_t *map = nullptr;
+		uint64_t lastUse = 0;
+	};
+
+	std::string m_path;
+	int m_fd = -1;
+	const CaptureHeader *m_header = nullptr;
+	std::array<Mapping, WindowChunks> m_window;
+	uint64_t m_uses = 0;
+};
+
+/**
+ * Capture the receiving threads record into, if any
+ * Changes only become visible to receiving threads once they passed their lock
+ */
+CaptureWriter *GetActiveCapture();
+void SetActiveCapture(CaptureWriter *capture);
+
+#endif // CAPTURE_H
@@ -0,0 +1,113 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "clock.hpp"
+
+#include "util/log.hpp"
+
+#include <cmath>
+#include <limits>
+
+
+/*
+ * Clock synchronisation between system clock and steady clock
+ */
+
+static ClockSync ClockSyncInstance;
+ClockSync &GetClockSync() { return ClockSyncInstance; }
+
+// Interval in which the estimate is refreshed
+static const long refreshIntervalMS = 1000;
+// Number of clock samples per refresh, of which the one with the shortest round-trip is used
+static const int refreshSamples = 16;
+// Deviation from prediction above which the system clock is considered to have jumped
+static const double resetThresholdUS = 2000;
+// Gains of alpha-beta filter for offset and drift
+static const double filterAlpha = 0.2, filterBeta = 0.02;
+
+void ClockSync::start()
+{
+	refresh();
+	m_thread = std::jthread([this](std::stop_token stop_token)
+	{
+		std::unique_lock lock(m_threadMutex);
+		while (!stop_token.stop_requested())
+		{
+			m_threadWake.wait_for(lock, stop_token, std::chrono::milliseconds(refreshIntervalMS), []{ return false; });
+			if (stop_token.stop_requested()) break;
+			lock.unlock();
+			refresh();
+			lock.lock();
+		}
+	});
+}
+
+void ClockSync::stop()
+{
+	m_thread = {};
+}
+
+void ClockSync::refresh()
+{
+	std::unique_lock lock(m_refreshMutex);
+
+	// Sample both clocks, and use sample with shortest round-trip to minimise effect of scheduling noise
+	long long bestRoundTripNS = std::numeric_limits<long long>::max();
+	long long steadyUS = 0, systemUS = 0;
+	for (int i = 0; i < refreshSamples; i++)
+	{
+		TimePoint_t t0 = sclock::now();
+		auto sys = std::chrono::system_clock::now();
+		TimePoint_t t1 = sclock::now();
+		long long roundTripNS = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+		if (roundTripNS >= bestRoundTripNS) continue;
+		bestRoundTripNS = roundTripNS;
+		steadyUS = toUS(t0 + (t1 - t0)/2);
+		systemUS = std::chrono::duration_cast<std::chrono::microseconds>(sys.time_since_epoch()).count();
+	}
+	double measuredUS = systemUS - steadyUS;
+
+	Estimate est = m_estimate.peek();
+	double predictedUS = est.offsetUS + est.drift * (steadyUS - est.referenceUS);
+	double residualUS = measuredUS - predictedUS;
+	if (est.updates == 0 || std::abs(residualUS) > resetThresholdUS)
+	{ // Initial estimate, or system clock jumped
+		if (est.updates > 0)
+			LOG(LIO, LInfo, "System clock jumped by %.2fms, resetting clock estimate!", residualUS/1000.0);
+		est.offsetUS = measuredUS;
+		est.drift = 0;
+	}
+	else
+	{ // Alpha-beta filter
+		double intervalUS = std::max<double>(steadyUS - est.referenceUS, 1);
+		est.offsetUS = predictedUS + filterAlpha * residualUS;
+		est.drift += filterBeta * residualUS / intervalUS;
+	}
+	est.referenceUS = steadyUS;
+	est.roundTripUS = bestRoundTripNS/1000.0;
+	est.residualUS = residualUS;
+	est.updates++;
+	m_estimate.write(est);
+}
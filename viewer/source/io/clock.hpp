@@ -0,0 +1,96 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "util/util.hpp" // TimePoint_t
+#include "util/seqlock.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Keeps a filtered estimate of the offset between the system clock (timestamps used by e.g. VRPN) and the steady clock
+ * Refreshed periodically in the background by sampling both clocks and picking the sample with the shortest round-trip
+ * Tracks drift between both clocks, and resets the estimate if the system clock jumps (e.g. NTP step)
+ * Conversions only read the current estimate instead of sampling both clocks every time
+ */
+class ClockSync
+{
+public:
+	struct Estimate
+	{
+		double offsetUS = 0; // System time - steady time at reference
+		long long referenceUS = 0; // Steady time of the last update
+		double drift = 0; // Change of offset per steady time
+		double roundTripUS = 0; // Round-trip of best sample of last update
+		double residualUS = 0; // Deviation of last update from prediction
+		unsigned int updates = 0;
+	};
+
+	void start();
+	void stop();
+
+	/**
+	 * Sample both clocks and update the estimate
+	 */
+	void refresh();
+
+	Estimate estimate() const { return m_estimate.read(); }
+
+	long long toSystemUS(TimePoint_t time) const
+	{
+		Estimate est = m_estimate.read();
+		long long steadyUS = toUS(time);
+		return steadyUS + (long long)(est.offsetUS + est.drift * (steadyUS - est.referenceUS));
+	}
+
+	TimePoint_t fromSystemUS(long long systemUS) const
+	{
+		Estimate est = m_estimate.read();
+		// Drift over the difference between the estimated and the exact steady time is negligible
+		long long steadyUS = systemUS - (long long)est.offsetUS;
+		steadyUS -= (long long)(est.drift * (steadyUS - est.referenceUS));
+		return TimePoint_t(std::chrono::microseconds(steadyUS));
+	}
+
+	static inline long long toUS(TimePoint_t time)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+	}
+
+private:
+	SeqLock<Estimate> m_estimate;
+	std::mutex m_refreshMutex; // Only one writer for m_estimate
+	std::mutex m_threadMutex;
+	std::condition_variable_any m_threadWake;
+	std::jthread m_thread;
+};
+
+ClockSync &GetClockSync();
+
+#endif // CLOCK_H
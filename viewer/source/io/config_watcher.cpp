@@ -0,0 +1,153 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "config_watcher.hpp"
+
+#include "util/log.hpp"
+#include "util/util.hpp" // TimePoint_t
+
+#include <filesystem>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ * Watching config file for changes
+ */
+
+ConfigWatcher::ConfigWatcher(std::string path, std::function<void()> onChange)
+	: m_path(std::move(path)), m_onChange(std::move(onChange))
+{
+	m_thread = std::jthread([this](std::stop_token stop_token){ run(stop_token); });
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+	stop();
+}
+
+void ConfigWatcher::stop()
+{
+	if (!m_thread.joinable()) return;
+	m_thread.request_stop();
+	m_thread.join();
+}
+
+#ifdef __linux__
+
+void ConfigWatcher::run(std::stop_token stop_token)
+{
+	std::filesystem::path path(m_path);
+	std::string directory = path.has_parent_path()? path.parent_path().string() : ".";
+	std::string filename = path.filename().string();
+
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+	{
+		LOG(LDefault, LError, "Failed to watch config file '%s': %s", m_path.c_str(), strerror(errno));
+		return;
+	}
+	// Watch directory instead of file, editors commonly save by replacing the file
+	if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0)
+	{
+		if (errno == ENOENT)
+		{
+			LOG(LDefault, LDebug, "Config directory '%s' does not exist, not watching for changes!", directory.c_str());
+		}
+		else
+		{
+			LOG(LDefault, LError, "Failed to watch config directory '%s': %s", directory.c_str(), strerror(errno));
+		}
+		close(fd);
+		return;
+	}
+	LOG(LDefault, LDebug, "Watching config file '%s' for changes!", m_path.c_str());
+
+	bool pending = false;
+	TimePoint_t lastChange;
+	alignas(struct inotify_event) char buffer[4096];
+	while (!stop_token.stop_requested())
+	{
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		int timeoutMS = pending? std::max<long>(DebounceUS - dtUS(lastChange, sclock::now()), 0)/1000+1 : PollIntervalUS/1000;
+		if (poll(&pfd, 1, timeoutMS) > 0)
+		{
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+			{
+				for (char *ptr = buffer; ptr < buffer + length;)
+				{
+					auto *event = (struct inotify_event*)ptr;
+					if (event->len > 0 && filename == event->name)
+					{
+						pending = true;
+						lastChange = sclock::now();
+					}
+					ptr += sizeof(struct inotify_event) + event->len;
+				}
+			}
+		}
+		if (pending && dtUS(lastChange, sclock::now()) >= DebounceUS)
+		{
+			pending = false;
+			if (std::filesystem::exists(m_path))
+				m_onChange();
+		}
+	}
+	close(fd);
+}
+
+#else
+
+void ConfigWatcher::run(std::stop_token stop_token)
+{
+	std::error_code error;
+	auto lastWrite = std::filesystem::last_write_time(m_path, error);
+	bool pending = false;
+	TimePoint_t lastChange;
+	while (!stop_token.stop_requested())
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(PollIntervalUS));
+		auto write = std::filesystem::last_write_time(m_path, error);
+		if (!error && write != lastWrite)
+		{
+			lastWrite = write;
+			pending = true;
+			lastChange = sclock::now();
+		}
+		if (pending && dtUS(lastChange, sclock::now()) >= DebounceUS)
+		{
+			pending = false;
+			m_onChange();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <string>
+#include <functional>
+#include <thread>
+
+/**
+ * Watches a file for changes in a background thread, calling back once writes settled
+ * Uses inotify on the parent directory where available, so that editors replacing the file are noticed as well
+ * Elsewhere falls back to polling the modification time
+ */
+class ConfigWatcher
+{
+public:
+	static constexpr long DebounceUS = 200000; // Editors may write in several steps
+	static constexpr long PollIntervalUS = 100000; // To check for stop, or modification time without inotify
+
+	/**
+	 * Start watching, onChange is called from the watcher thread
+	 */
+	ConfigWatcher(std::string path, std::function<void()> onChange);
+	~ConfigWatcher();
+
+	/**
+	 * Stop background thread, must not be called with locks held that onChange takes
+	 */
+	void stop();
+
+private:
+	std::string m_path;
+	std::function<void()> m_onChange;
+
+	// Declared last so that it is joined before anything else is destroyed
+	std::jthread m_thread;
+
+	void run(std::stop_token stop_token);
+};
+
+#endif // CONFIG_WATCHER_H
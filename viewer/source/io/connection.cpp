@@ -0,0 +1,291 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "connection.hpp"
+
+#include "client.hpp"
+
+#include "util/log.hpp"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#endif
+
+
+/* Name resolution */
+
+/**
+ * Extract host to resolve from a VRPN device name (e.g. Tracker0@host:port or Tracker0@tcp://host:port)
+ * Returns an empty string if the connection does not need name resolution (e.g. local or log files)
+ */
+static std::string resolvableHost(const std::string &path)
+{
+	auto at = path.find('@');
+	if (at == std::string::npos) return "";
+	std::string host = path.substr(at+1);
+	auto scheme = host.find("://");
+	if (scheme != std::string::npos)
+	{
+		if (host.compare(0, scheme, "x-vrpnlog") == 0 || host.compare(0, scheme, "file") == 0)
+			return "";
+		host = host.substr(scheme+3);
+	}
+	if (host.compare(0, 5, "file:") == 0)
+		return "";
+	auto port = host.find(':');
+	if (port != std::string::npos)
+		host = host.substr(0, port);
+	if (host.empty() || host == "localhost")
+		return "";
+	return host;
+}
+
+static bool resolveHost(const std::string &host)
+{
+	struct addrinfo hints = {}, *result = nullptr;
+	hints.ai_family = AF_INET; // VRPN only supports IPv4
+	int error = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+	if (result) freeaddrinfo(result);
+	return error == 0;
+}
+
+
+/* Connection Manager */
+
+ConnectionManager::ConnectionManager(ClientState &state) : m_state(state)
+{
+	m_thread = std::jthread([this](std::stop_token stop_token){ run(stop_token); });
+}
+
+ConnectionManager::~ConnectionManager()
+{
+	stop();
+}
+
+void ConnectionManager::stop()
+{
+	if (!m_thread.joinable()) return;
+	m_thread.request_stop();
+	m_thread.join();
+}
+
+void ConnectionManager::request(vrpn_Tracker_Wrapper &tracker, long delayUS)
+{
+	enqueue(tracker, delayUS);
+	setStatus(tracker, TrackerStatus::Searching);
+}
+
+void ConnectionManager::enqueue(vrpn_Tracker_Wrapper &tracker, long delayUS)
+{
+	{
+		auto lock = std::unique_lock(m_mutex);
+		uint32_t generation = ++m_generation[tracker.handle];
+		std::erase_if(m_requests, [&](auto &request){ return request.tracker == tracker.handle; });
+		m_requests.push_back({ tracker.handle, generation, tracker.path, sclock::now() + std::chrono::microseconds(delayUS) });
+	}
+	m_wakeup.notify_all();
+}
+
+long ConnectionManager::backoffUS(int attempts)
+{
+	return std::min(BackoffMinUS << std::min(attempts, 6), BackoffMaxUS);
+}
+
+void ConnectionManager::cancel(vrpn_Tracker_Wrapper &tracker)
+{
+	{
+		auto lock = std::unique_lock(m_mutex);
+		// Invalidates any request currently being connected
+		m_generation.erase(tracker.handle);
+		m_attempts.erase(tracker.handle);
+		std::erase_if(m_requests, [&](auto &request){ return request.tracker == tracker.handle; });
+	}
+	setStatus(tracker, TrackerStatus::Idle);
+}
+
+std::vector<ConnectionManager::Event> ConnectionManager::events()
+{
+	auto lock = std::unique_lock(m_mutex);
+	std::vector<Event> events(m_events.begin(), m_events.end());
+	m_events.clear();
+	return events;
+}
+
+void ConnectionManager::setStatus(vrpn_Tracker_Wrapper &tracker, TrackerStatus status)
+{ // Expects io.mutex to be held, so tracker can only change status from one thread at a time
+	if (tracker.status.exchange(status) == status) return;
+	auto lock = std::unique_lock(m_mutex);
+	m_events.push_back({ tracker.handle, status, sclock::now() });
+	while (m_events.size() > MaxEvents)
+		m_events.pop_front();
+}
+
+void ConnectionManager::run(std::stop_token stop_token)
+{
+	while (!stop_token.stop_requested())
+	{
+		Request due;
+		bool hasDue = false;
+		{
+			auto lock = std::unique_lock(m_mutex);
+			auto earliest = [&]()
+			{
+				return std::min_element(m_requests.begin(), m_requests.end(),
+					[](auto &a, auto &b){ return a.due < b.due; });
+			};
+			TimePoint_t wakeup = m_lastMonitor + std::chrono::microseconds(MonitorIntervalUS);
+			auto next = earliest();
+			if (next != m_requests.end() && next->due < wakeup)
+				wakeup = next->due;
+			m_wakeup.wait_until(lock, stop_token, wakeup, [&]()
+			{ // Woken up early by new requests
+				auto next = earliest();
+				return next != m_requests.end() && next->due <= sclock::now();
+			});
+			auto ready = earliest();
+			if (ready != m_requests.end() && ready->due <= sclock::now())
+			{
+				due = std::move(*ready);
+				m_requests.erase(ready);
+				hasDue = true;
+			}
+		}
+		if (stop_token.stop_requested()) break;
+
+		if (hasDue)
+			connect(std::move(due));
+		if (dtUS(m_lastMonitor, sclock::now()) >= MonitorIntervalUS)
+		{
+			monitor();
+			m_lastMonitor = sclock::now();
+		}
+	}
+}
+
+void ConnectionManager::retry(Request request)
+{
+	long delayUS;
+	{
+		auto lock = std::unique_lock(m_mutex);
+		auto gen = m_generation.find(request.tracker);
+		if (gen == m_generation.end() || gen->second != request.generation)
+			return; // Cancelled or replaced in the meantime
+		delayUS = backoffUS(m_attempts[request.tracker]++);
+		request.due = sclock::now() + std::chrono::microseconds(delayUS);
+		m_requests.push_back(std::move(request));
+	}
+	LOG(LIO, LDebug, "Retrying connection in %.1fs!", delayUS/1000000.0f);
+}
+
+void ConnectionManager::connect(Request request)
+{
+	// Potentially blocking for a long time, so done without holding any locks
+	std::string host = resolvableHost(request.path);
+	if (!host.empty() && !resolveHost(host))
+	{
+		LOG(LIO, LWarn, "Failed to resolve host '%s' of tracker %s!", host.c_str(), request.path.c_str());
+		retry(std::move(request));
+		return;
+	}
+	// The reference count of connections is not synchronized, so they may only be acquired or released with io.mutex held
+	// Declared first so that the lock outlives the reference taken here on every return path
+	auto io_lock = std::unique_lock(m_state.io.mutex);
+	// Returns an existing connection if another tracker already uses the same server
+	opaque_ptr<vrpn_Connection> connection(vrpn_get_connection_by_name(request.path.c_str()));
+	if (!connection || !connection->doing_okay())
+	{
+		LOG(LIO, LWarn, "Failed to create connection for tracker %s!", request.path.c_str());
+		connection = nullptr;
+		io_lock.unlock();
+		retry(std::move(request));
+		return;
+	}
+	{
+		auto lock = std::unique_lock(m_mutex);
+		auto gen = m_generation.find(request.tracker);
+		if (gen == m_generation.end() || gen->second != request.generation)
+			return; // Cancelled or replaced in the meantime, connection is released if unused
+	}
+	vrpn_Tracker_Wrapper *tracker = m_state.io.vrpn_trackers.get(request.tracker);
+	if (!tracker || tracker->receiver)
+		return;
+	AttachTracker(m_state, *tracker, std::move(connection));
+}
+
+void ConnectionManager::monitor()
+{
+	TimePoint_t now = sclock::now();
+	auto io_lock = std::unique_lock(m_state.io.mutex);
+	for (auto &tracker : m_state.io.vrpn_trackers)
+	{
+		if (tracker.replay || !tracker.receiver) continue;
+		vrpn_Connection *connection = tracker.receiver->connection.get();
+		TrackerStatus status = tracker.status.load(std::memory_order_relaxed);
+
+		if (!connection->doing_okay())
+		{ // VRPN does not recover broken connections, so create a new one
+			LOG(LIO, LWarn, "Connection of tracker %s broke, reconnecting!", tracker.path.c_str());
+			DetachTracker(m_state, tracker);
+			long delayUS;
+			{
+				auto lock = std::unique_lock(m_mutex);
+				delayUS = backoffUS(m_attempts[tracker.handle]++);
+			}
+			enqueue(tracker, delayUS);
+			setStatus(tracker, TrackerStatus::Lost);
+			continue;
+		}
+
+		auto published = tracker.published.read();
+		bool receiving = published.packets > 0 && dtUS(published.lastPacket, now) < TrackingTimeoutUS;
+		if (receiving)
+		{
+			if (status != TrackerStatus::Tracking)
+			{
+				auto lock = std::unique_lock(m_mutex);
+				m_attempts.erase(tracker.handle);
+			}
+			status = TrackerStatus::Tracking;
+		}
+		else if (status == TrackerStatus::Tracking || status == TrackerStatus::Lost)
+			status = TrackerStatus::Lost;
+		else if (connection->connected())
+			status = TrackerStatus::Connected;
+		else if (status == TrackerStatus::Connected)
+			status = TrackerStatus::Lost;
+		else
+			status = TrackerStatus::Searching;
+		if (status != tracker.status.load(std::memory_order_relaxed))
+		{
+			LOG(LIO, status == TrackerStatus::Lost? LWarn : LInfo, "Tracker %s is now %s!",
+				tracker.path.c_str(), TrackerStatusName(status));
+			setStatus(tracker, status);
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "io/vrpn.hpp"
+
+#include "util/util.hpp" // TimePoint_t
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct ClientState;
+
+/**
+ * Establishes tracker connections in a background thread, so that neither UI nor receiving threads block on
+ * name resolution or connection setup to unreachable hosts
+ * Failed or broken connections are retried with exponential backoff
+ * Monitors connected trackers and publishes their status transitions as events
+ */
+class ConnectionManager
+{
+public:
+	struct Event
+	{
+		SlotHandle tracker;
+		TrackerStatus status;
+		TimePoint_t time;
+	};
+
+	static constexpr long BackoffMinUS = 500000, BackoffMaxUS = 30000000;
+	static constexpr long MonitorIntervalUS = 100000;
+	static constexpr long TrackingTimeoutUS = 250000;
+	static constexpr int MaxEvents = 256;
+
+	ConnectionManager(ClientState &state);
+	~ConnectionManager();
+
+	/**
+	 * Request tracker to be connected, replacing any previous request (io.mutex held)
+	 */
+	void request(vrpn_Tracker_Wrapper &tracker, long delayUS = 0);
+
+	/**
+	 * Cancel any pending request of tracker, if it is still in progress it will be discarded (io.mutex held)
+	 */
+	void cancel(vrpn_Tracker_Wrapper &tracker);
+
+	/**
+	 * Take all status transitions since the last call, only the latest MaxEvents are kept
+	 */
+	std::vector<Event> events();
+
+	/**
+	 * Stop background thread, must not be called with io.mutex held
+	 */
+	void stop();
+
+private:
+	struct Request
+	{
+		SlotHandle tracker;
+		uint32_t generation;
+		std::string path;
+		TimePoint_t due;
+	};
+	ClientState &m_state;
+
+	std::mutex m_mutex; // Protects requests, generations and events
+	std::condition_variable_any m_wakeup;
+	std::deque<Request> m_requests;
+	std::unordered_map<SlotHandle, uint32_t> m_generation; // Current request of each tracker
+	std::unordered_map<SlotHandle, int> m_attempts; // Failed attempts since last success, for backoff
+	std::deque<Event> m_events;
+
+	TimePoint_t m_lastMonitor = {}; // Only accessed by manager thread
+
+	// Declared last so that it is joined before anything else is destroyed
+	std::jthread m_thread;
+
+	void run(std::stop_token stop_token);
+	void enqueue(vrpn_Tracker_Wrapper &tracker, long delayUS);
+	static long backoffUS(int attempts);
+	void connect(Request request);
+	void retry(Request request);
+	void monitor();
+	void setStatus(vrpn_Tracker_Wrapper &tracker, TrackerStatus status);
+};
+
+#endif // CONNECTION_H
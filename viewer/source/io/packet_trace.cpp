@@ -0,0 +1,101 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "packet_trace.hpp"
+
+#include <algorithm>
+
+
+/*
+ * Binary trace of received packets
+ */
+
+static PacketTrace PacketTraceInstance;
+PacketTrace &GetPacketTrace() { return PacketTraceInstance; }
+
+thread_local PacketTrace::Ring *PacketTrace::m_threadRing = nullptr;
+
+PacketTrace::Writer::Writer(PacketTrace &trace) : m_trace(trace)
+{
+	std::unique_lock lock(m_trace.m_ringsMutex);
+	auto ring = std::find_if(m_trace.m_rings.begin(), m_trace.m_rings.end(),
+		[](auto &ring){ return !ring->assigned; });
+	if (ring == m_trace.m_rings.end())
+	{
+		m_trace.m_rings.push_back(std::make_unique<Ring>());
+		ring = std::prev(m_trace.m_rings.end());
+	}
+	(*ring)->assigned = true;
+	m_threadRing = ring->get();
+}
+
+PacketTrace::Writer::~Writer()
+{ // Records stay collectable until the next thread assigned this ring overwrites them
+	std::unique_lock lock(m_trace.m_ringsMutex);
+	m_threadRing->assigned = false;
+	m_threadRing = nullptr;
+}
+
+void PacketTrace::record(const PacketRecord &record)
+{
+	Ring *ring = m_threadRing;
+	if (!ring) return;
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	// Mark oldest record as being overwritten before touching it
+	ring->claimed.store(head+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	ring->records[head % RingSize] = record;
+	ring->head.store(head+1, std::memory_order_release);
+}
+
+void PacketTrace::collect(Cursors &cursors, std::vector<PacketRecord> &records)
+{
+	std::size_t start = records.size();
+	std::unique_lock lock(m_ringsMutex);
+	std::size_t known = cursors.positions.size();
+	cursors.positions.resize(m_rings.size(), 0);
+	for (std::size_t r = 0; r < m_rings.size(); r++)
+	{
+		Ring &ring = *m_rings[r];
+		uint64_t &cursor = cursors.positions[r];
+		uint64_t head = ring.head.load(std::memory_order_acquire);
+		if (r >= known) // Start at oldest record available, anything before was never missed
+			cursor = head > RingSize? head-RingSize : 0;
+		uint64_t begin = std::max<uint64_t>(cursor, head > RingSize? head-RingSize : 0);
+		std::size_t base = records.size();
+		for (uint64_t i = begin; i < head; i++)
+			records.push_back(ring.records[i % RingSize]);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		// Discard records that have been (or are being) overwritten while copying
+		uint64_t claimed = ring.claimed.load(std::memory_order_relaxed);
+		uint64_t valid = std::clamp<uint64_t>(claimed > RingSize? claimed-RingSize : 0, begin, head);
+		records.erase(records.begin()+base, records.begin()+base+(valid-begin));
+		cursors.dropped += valid - cursor;
+		cursor = head;
+	}
+	lock.unlock();
+	std::stable_sort(records.begin()+start, records.end(),
+		[](auto &a, auto &b){ return a.received < b.received; });
+}
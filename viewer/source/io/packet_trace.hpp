@@ -0,0 +1,110 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PACKET_TRACE_H
+#define PACKET_TRACE_H
+
+#include "util/util.hpp" // TimePoint_t
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Fixed-size binary record of a single received packet, only formatted when displayed
+ */
+struct PacketRecord
+{
+	enum Type : uint8_t { Pose, Velocity, Accel };
+	Type type;
+	int16_t sensor;
+	uint32_t tracker; // vrpn_Tracker_Wrapper::id
+	TimePoint_t timestamp, received;
+	float vec[3]; // Position, velocity or acceleration
+	float quat[4]; // x, y, z, w
+};
+
+/**
+ * Trace of received packets for diagnostics, written by any number of receiving threads without locking or formatting
+ * Each writing thread appends to its own ring buffer, overwriting the oldest records once full
+ * Rings are assigned when a thread starts writing (see Writer) and reused by later threads once it exits
+ * Readers incrementally collect new records using a cursor per ring and verify afterwards they were not overwritten
+ */
+class PacketTrace
+{
+public:
+	static const int RingSize = 1<<14;
+
+	struct Cursors
+	{
+		std::vector<uint64_t> positions;
+		uint64_t dropped = 0;
+	};
+
+	/**
+	 * Assigns a ring to the calling thread for its lifetime, to create at the start of each receiving thread
+	 * Keeps allocations off the receive path, and returns the ring to the pool when the thread exits
+	 */
+	class Writer
+	{
+	public:
+		Writer(PacketTrace &trace);
+		~Writer();
+		Writer(const Writer&) = delete;
+		Writer &operator=(const Writer&) = delete;
+	private:
+		PacketTrace &m_trace;
+	};
+
+	/**
+	 * Append record to the ring of the calling thread, ignored if the thread has no Writer
+	 */
+	void record(const PacketRecord &record);
+
+	/**
+	 * Append all records written since the last call with the same cursors, sorted by time received
+	 * New cursors start at the oldest record still available, without counting older ones as dropped
+	 * Records that were overwritten before they could be collected are counted as dropped
+	 */
+	void collect(Cursors &cursors, std::vector<PacketRecord> &records);
+
+private:
+	struct Ring
+	{
+		std::atomic<uint64_t> claimed = 0; // Incremented before writing a record
+		std::atomic<uint64_t> head = 0; // Incremented after writing a record, never reset so cursors stay valid on reuse
+		bool assigned = false; // Protected by m_ringsMutex
+		PacketRecord records[RingSize];
+	};
+	std::mutex m_ringsMutex; // Only for assigning rings to threads and collecting
+	std::vector<std::unique_ptr<Ring>> m_rings; // Never removed, only reused, so cursors stay valid
+	static thread_local Ring *m_threadRing;
+};
+
+PacketTrace &GetPacketTrace();
+
+#endif // PACKET_TRACE_H
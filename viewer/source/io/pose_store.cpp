@@ -0,0 +1,209 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "pose_store.hpp"
+
+
+/* Sampling of pose history */
+
+bool PoseStore::sampleHistory(const Block::History &history, TimePoint_t time, long maxExtrapolationUS, Sample &sample) const
+{
+	while (true)
+	{
+		uint32_t head = history.head.load(std::memory_order_acquire);
+		if (head == 0) return false;
+		// Oldest sample that may be read, the one before it might currently be getting overwritten
+		uint32_t first = head > HistorySize-1? head-(HistorySize-1) : 0;
+
+		// Find newest sample not newer than time, or oldest sample
+		uint32_t index = head-1;
+		while (index > first && history.timestamp[index%HistorySize] > time)
+			index--;
+		// Pick second sample to interpolate towards, or extrapolate from
+		bool extrapolate = index == head-1;
+		uint32_t other = extrapolate? index-1 : index+1;
+		bool single = extrapolate && index == first;
+
+		TimePoint_t t0 = history.timestamp[index%HistorySize];
+		Eigen::Vector3f p0 = history.position[index%HistorySize];
+		Eigen::Quaternionf q0 = history.rotation[index%HistorySize];
+		TimePoint_t t1;
+		Eigen::Vector3f p1;
+		Eigen::Quaternionf q1;
+		if (!single)
+		{
+			t1 = history.timestamp[other%HistorySize];
+			p1 = history.position[other%HistorySize];
+			q1 = history.rotation[other%HistorySize];
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (history.head.load(std::memory_order_relaxed) >= first+HistorySize)
+			continue; // Writer overtook us, samples might be corrupted
+
+		sample.timestamp = time;
+		if (single || t0 > time)
+		{ // Only one sample or time is older than history
+			sample.position = p0;
+			sample.rotation = q0;
+		}
+		else if (extrapolate)
+		{ // Extrapolate from latest two samples (t1 < t0 <= time) for a bounded time
+			long intervalUS = dtUS(t1, t0);
+			long aheadUS = std::min(dtUS(t0, time), maxExtrapolationUS);
+			float factor = intervalUS > 0? (float)aheadUS / intervalUS : 0.0f;
+			sample.position = p0 + (p0 - p1) * factor;
+			Eigen::AngleAxisf delta(q0 * q1.conjugate());
+			delta.angle() *= factor;
+			sample.rotation = (Eigen::Quaternionf(delta) * q0).normalized();
+		}
+		else
+		{ // Interpolate between the two samples (t0 <= time < t1)
+			long intervalUS = dtUS(t0, t1);
+			float factor = intervalUS > 0? (float)dtUS(t0, time) / intervalUS : 0.0f;
+			sample.position = p0 + (p1 - p0) * factor;
+			sample.rotation = q0.slerp(factor, q1);
+		}
+		return true;
+	}
+}
+
+
+/* Motion of sensors */
+
+// Rotation vector (axis * angle) of a rotation, taking the shortest path
+static inline Eigen::Vector3f rotationVector(Eigen::Quaternionf rot)
+{
+	if (rot.w() < 0) rot.coeffs() = -rot.coeffs();
+	Eigen::AngleAxisf aa(rot);
+	return aa.axis() * aa.angle();
+}
+
+bool PoseStore::estimateMotion(const Block::History &history, Motion &motion) const
+{
+	// Savitzky-Golay style differentiator: Local least squares polynomial fit over the latest samples,
+	// evaluated at the latest sample, generalised to the irregular sample times of received poses
+	const int MaxSamples = 7; // Trade-off between noise suppression and lag
+	const long MaxWindowUS = 100000; // Ignore samples too old to describe current motion
+	std::array<TimePoint_t, MaxSamples> times;
+	std::array<Eigen::Vector3f, MaxSamples> positions;
+	std::array<Eigen::Quaternionf, MaxSamples> rotations;
+	int count;
+	while (true)
+	{
+		uint32_t head = history.head.load(std::memory_order_acquire);
+		if (head < 2) return false;
+		uint32_t first = head > HistorySize-1? head-(HistorySize-1) : 0;
+		count = std::min<int>(MaxSamples, head-first);
+		for (int i = 0; i < count; i++)
+		{ // Newest first
+			uint32_t index = head-1-i;
+			times[i] = history.timestamp[index%HistorySize];
+			positions[i] = history.position[index%HistorySize];
+			rotations[i] = history.rotation[index%HistorySize];
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (history.head.load(std::memory_order_relaxed) < first+HistorySize)
+			break; // Else writer overtook us, samples might be corrupted
+	}
+	int samples = 1;
+	while (samples < count && dtUS(times[samples], times[0]) <= MaxWindowUS)
+		samples++;
+	if (samples < 2) return false;
+
+	// Fit quadratic with enough samples to suppress noise, else just linear
+	int order = samples >= 4? 2 : 1;
+	// Normal equations of p(t) = c0 + c1*t + c2*t^2 with t in seconds relative to the latest sample
+	Eigen::Matrix3d normal = Eigen::Matrix3d::Zero();
+	Eigen::Matrix3d rhsPos = Eigen::Matrix3d::Zero(), rhsRot = Eigen::Matrix3d::Zero();
+	Eigen::Quaternionf invLatest = rotations[0].conjugate();
+	for (int i = 0; i < samples; i++)
+	{
+		double t = -dtUS(times[i], times[0]) / 1000000.0;
+		Eigen::Vector3d basis(1, t, t*t);
+		normal += basis * basis.transpose();
+		rhsPos += basis * (positions[i] - positions[0]).cast<double>().transpose();
+		rhsRot += basis * rotationVector(rotations[i] * invLatest).cast<double>().transpose();
+	}
+	// Bounded dynamic size to avoid allocations
+	typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 3, 3> FitMatrix;
+	int n = order+1;
+	Eigen::LDLT<FitMatrix> solver(FitMatrix(normal.topLeftCorner(n, n)));
+	if (solver.info() != Eigen::Success)
+		return false;
+	FitMatrix coeffPos = solver.solve(FitMatrix(rhsPos.topRows(n)));
+	FitMatrix coeffRot = solver.solve(FitMatrix(rhsRot.topRows(n)));
+	if (!coeffPos.allFinite() || !coeffRot.allFinite())
+		return false;
+
+	motion.velocity = coeffPos.row(1).transpose().cast<float>();
+	motion.angularVelocity = coeffRot.row(1).transpose().cast<float>();
+	if (order == 2)
+	{
+		motion.acceleration = 2 * coeffPos.row(2).transpose().cast<float>();
+		motion.angularAcceleration = 2 * coeffRot.row(2).transpose().cast<float>();
+	}
+	else
+	{
+		motion.acceleration.setZero();
+		motion.angularAcceleration.setZero();
+	}
+	motion.velocityTimestamp = motion.accelerationTimestamp = times[0];
+	motion.reported = false;
+	return true;
+}
+
+bool PoseStore::readMotion(const Block &block, int i, const Sample &latest, Motion &motion) const
+{
+	if (block.motion[i].sequence() > 0)
+	{
+		motion = block.motion[i].read();
+		bool velocityRecent = dtUS(motion.velocityTimestamp, latest.timestamp) < MotionTimeoutUS;
+		bool accelerationRecent = dtUS(motion.accelerationTimestamp, latest.timestamp) < MotionTimeoutUS;
+		if (velocityRecent)
+		{ // Prefer motion reported by the server, it likely has more information than the poses
+			if (!accelerationRecent)
+			{
+				motion.acceleration.setZero();
+				motion.angularAcceleration.setZero();
+			}
+			motion.reported = true;
+			return true;
+		}
+	}
+	return estimateMotion(block.history[i], motion);
+}
+
+void PoseStore::extrapolate(const Motion &motion, TimePoint_t time, long maxPredictionUS, Sample &sample) const
+{
+	float dt = std::min(dtUS(sample.timestamp, time), maxPredictionUS) / 1000000.0f;
+	if (dt <= 0) return;
+	sample.position += motion.velocity * dt + motion.acceleration * (dt*dt/2);
+	Eigen::Vector3f rotation = motion.angularVelocity * dt + motion.angularAcceleration * (dt*dt/2);
+	float angle = rotation.norm();
+	if (angle > 0.000001f)
+		sample.rotation = (Eigen::Quaternionf(Eigen::AngleAxisf(angle, rotation / angle)) * sample.rotation).normalized();
+	sample.timestamp = time;
+}
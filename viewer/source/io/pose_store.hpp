@@ -0,0 +1,347 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef POSE_STORE_H
+#define POSE_STORE_H
+
+#include "util/eigendef.hpp"
+#include "util/util.hpp" // TimePoint_t
+#include "util/seqlock.hpp"
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Dense structure-of-arrays store of the latest pose of every sensor of a tracker, indexed by sensor id
+ * Written by a single thread (the receiving thread), read by any thread without locking
+ * Sensors are stored in blocks of fixed size that are never moved, so readers may access them while the store grows
+ * Each sensor is protected by its own sequence lock, with sequence/2 being the number of updates it received
+ * Additionally, each sensor keeps a short history of timestamped poses to sample poses at arbitrary times
+ * Velocity and acceleration reported by the server are stored alongside, else they are estimated from the history
+ */
+class PoseStore
+{
+public:
+	static constexpr int BlockSize = 64;
+	static constexpr int MaxBlocks = 64;
+	static constexpr int MaxSensors = BlockSize*MaxBlocks;
+	static constexpr int HistorySize = 32;
+	// Reported motion older than this relative to the latest pose is considered stale and estimated instead
+	static constexpr long MotionTimeoutUS = 50000;
+
+	struct Sample
+	{
+		int sensor;
+		uint32_t updates;
+		Eigen::Vector3f position;
+		Eigen::Quaternionf rotation;
+		TimePoint_t timestamp, received;
+
+		inline Eigen::Isometry3f pose() const
+		{
+			Eigen::Isometry3f pose;
+			pose.linear() = rotation.toRotationMatrix();
+			pose.translation() = position;
+			return pose;
+		}
+	};
+
+	/**
+	 * First and second derivative of the pose of a sensor
+	 * Angular velocity and acceleration are in world space as axis * angle (rad/s and rad/s^2)
+	 */
+	struct Motion
+	{
+		Eigen::Vector3f velocity = Eigen::Vector3f::Zero(), angularVelocity = Eigen::Vector3f::Zero();
+		Eigen::Vector3f acceleration = Eigen::Vector3f::Zero(), angularAcceleration = Eigen::Vector3f::Zero();
+		TimePoint_t velocityTimestamp = {}, accelerationTimestamp = {}; // Default if never reported
+		bool reported = false; // Else estimated from pose history
+	};
+
+private:
+	struct Block
+	{
+		std::array<std::atomic<uint32_t>, BlockSize> sequence = {};
+		std::array<Eigen::Vector3f, BlockSize> position;
+		std::array<Eigen::Quaternionf, BlockSize> rotation;
+		std::array<TimePoint_t, BlockSize> timestamp;
+		std::array<TimePoint_t, BlockSize> received;
+
+		/**
+		 * Ring buffer of past poses by server timestamp
+		 * Readers verify with head after reading that the samples have not been overwritten in the meantime
+		 */
+		struct History
+		{
+			std::atomic<uint32_t> head = 0; // Index of next sample to write
+			std::array<TimePoint_t, HistorySize> timestamp;
+			std::array<Eigen::Vector3f, HistorySize> position;
+			std::array<Eigen::Quaternionf, HistorySize> rotation;
+		};
+		std::array<History, BlockSize> history;
+
+		// Motion as reported by the server, if any
+		std::array<SeqLock<Motion>, BlockSize> motion;
+	};
+
+	std::array<std::atomic<Block*>, MaxBlocks> m_blocks = {};
+	std::atomic<int> m_sensors = 0;
+
+	inline bool readBlock(const Block &block, int i, Sample &sample) const
+	{
+		uint32_t seq0, seq1;
+		do
+		{
+			seq0 = block.sequence[i].load(std::memory_order_acquire);
+			sample.position = block.position[i];
+			sample.rotation = block.rotation[i];
+			sample.timestamp = block.timestamp[i];
+			sample.received = block.received[i];
+			std::atomic_thread_fence(std::memory_order_acquire);
+			seq1 = block.sequence[i].load(std::memory_order_relaxed);
+		}
+		while ((seq0 & 1) || seq0 != seq1);
+		sample.updates = seq0/2;
+		return seq0 > 0;
+	}
+
+	Block *getBlock(int sensor)
+	{
+		Block *block = m_blocks[sensor/BlockSize].load(std::memory_order_relaxed);
+		if (!block)
+		{ // Only allocates once every BlockSize sensors
+			block = new Block();
+			m_blocks[sensor/BlockSize].store(block, std::memory_order_release);
+		}
+		return block;
+	}
+
+	bool sampleHistory(const Block::History &history, TimePoint_t time, long maxExtrapolationUS, Sample &sample) const;
+	bool estimateMotion(const Block::History &history, Motion &motion) const;
+	bool readMotion(const Block &block, int i, const Sample &latest, Motion &motion) const;
+	void extrapolate(const Motion &motion, TimePoint_t time, long maxPredictionUS, Sample &sample) const;
+
+public:
+	PoseStore() {}
+	PoseStore(const PoseStore&) = delete;
+	PoseStore &operator=(const PoseStore&) = delete;
+	~PoseStore()
+	{
+		for (auto &block : m_blocks)
+			delete block.load();
+	}
+
+	/**
+	 * Publish a new pose of a sensor (writer thread only)
+	 * Returns false if the sensor id is out of range
+	 */
+	bool write(int sensor, const Eigen::Vector3f &position, const Eigen::Quaternionf &rotation, TimePoint_t timestamp, TimePoint_t received)
+	{
+		if (sensor < 0 || sensor >= MaxSensors)
+			return false;
+		Block *block = getBlock(sensor);
+		int i = sensor%BlockSize;
+		uint32_t seq = block->sequence[i].load(std::memory_order_relaxed);
+		block->sequence[i].store(seq+1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		block->position[i] = position;
+		block->rotation[i] = rotation;
+		block->timestamp[i] = timestamp;
+		block->received[i] = received;
+		block->sequence[i].store(seq+2, std::memory_order_release);
+		auto &history = block->history[i];
+		uint32_t head = history.head.load(std::memory_order_relaxed);
+		history.timestamp[head%HistorySize] = timestamp;
+		history.position[head%HistorySize] = position;
+		history.rotation[head%HistorySize] = rotation;
+		history.head.store(head+1, std::memory_order_release);
+		if (m_sensors.load(std::memory_order_relaxed) <= sensor)
+			m_sensors.store(sensor+1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Publish the velocity of a sensor as reported by the server (writer thread only)
+	 * Returns false if the sensor id is out of range
+	 */
+	bool writeVelocity(int sensor, const Eigen::Vector3f &velocity, const Eigen::Vector3f &angularVelocity, TimePoint_t timestamp)
+	{
+		if (sensor < 0 || sensor >= MaxSensors)
+			return false;
+		getBlock(sensor)->motion[sensor%BlockSize].update([&](Motion &motion)
+		{
+			motion.velocity = velocity;
+			motion.angularVelocity = angularVelocity;
+			motion.velocityTimestamp = timestamp;
+		});
+		return true;
+	}
+
+	/**
+	 * Publish the acceleration of a sensor as reported by the server (writer thread only)
+	 * Returns false if the sensor id is out of range
+	 */
+	bool writeAcceleration(int sensor, const Eigen::Vector3f &acceleration, const Eigen::Vector3f &angularAcceleration, TimePoint_t timestamp)
+	{
+		if (sensor < 0 || sensor >= MaxSensors)
+			return false;
+		getBlock(sensor)->motion[sensor%BlockSize].update([&](Motion &motion)
+		{
+			motion.acceleration = acceleration;
+			motion.angularAcceleration = angularAcceleration;
+			motion.accelerationTimestamp = timestamp;
+		});
+		return true;
+	}
+
+	/**
+	 * Upper bound of sensor ids that have been written, not all sensors below need to exist
+	 */
+	int sensors() const
+	{
+		return m_sensors.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Read a consistent copy of the latest pose of a sensor
+	 * Returns false if the sensor has not received any updates yet
+	 */
+	bool read(int sensor, Sample &sample) const
+	{
+		if (sensor < 0 || sensor >= sensors())
+			return false;
+		const Block *block = m_blocks[sensor/BlockSize].load(std::memory_order_acquire);
+		if (!block) return false;
+		sample.sensor = sensor;
+		return readBlock(*block, sensor%BlockSize, sample);
+	}
+
+	/**
+	 * Sample the pose of a sensor at an arbitrary time from its history
+	 * Interpolates between past poses, or extrapolates from the latest poses by at most maxExtrapolationUS
+	 * Returns false if the sensor has not received any updates yet
+	 */
+	bool sample(int sensor, TimePoint_t time, long maxExtrapolationUS, Sample &sample) const
+	{
+		if (!read(sensor, sample))
+			return false;
+		const Block *block = m_blocks[sensor/BlockSize].load(std::memory_order_acquire);
+		return sampleHistory(block->history[sensor%BlockSize], time, maxExtrapolationUS, sample);
+	}
+
+	/**
+	 * Get the current motion of a sensor, as reported by the server if recent, else estimated from its pose history
+	 * Returns false if the sensor has not received any updates yet
+	 */
+	bool motion(int sensor, Motion &motion) const
+	{
+		Sample latest;
+		if (!read(sensor, latest))
+			return false;
+		const Block *block = m_blocks[sensor/BlockSize].load(std::memory_order_acquire);
+		return readMotion(*block, sensor%BlockSize, latest, motion);
+	}
+
+	/**
+	 * Predict the pose of a sensor at a future time by extrapolating its latest pose with its motion
+	 * Extrapolates by at most maxPredictionUS past the latest pose, e.g. to not overshoot when tracking is lost
+	 * Times older than the latest pose are sampled from history instead
+	 * Returns false if the sensor has not received any updates yet
+	 */
+	bool predict(int sensor, TimePoint_t time, long maxPredictionUS, Sample &sample) const
+	{
+		if (!read(sensor, sample))
+			return false;
+		const Block *block = m_blocks[sensor/BlockSize].load(std::memory_order_acquire);
+		if (time <= sample.timestamp)
+			return sampleHistory(block->history[sensor%BlockSize], time, 0, sample);
+		Motion motion;
+		if (readMotion(*block, sensor%BlockSize, sample, motion))
+			extrapolate(motion, time, maxPredictionUS, sample);
+		return true;
+	}
+
+	/**
+	 * Predict all sensors that received updates at a future time in bulk, block by block
+	 */
+	template<typename Func>
+	void forEachPredicted(TimePoint_t time, long maxPredictionUS, Func &&func) const
+	{
+		forEach([&](Sample &sample)
+		{
+			const Block *block = m_blocks[sample.sensor/BlockSize].load(std::memory_order_acquire);
+			if (time <= sample.timestamp)
+			{
+				if (sampleHistory(block->history[sample.sensor%BlockSize], time, 0, sample))
+					func(sample);
+				return;
+			}
+			Motion motion;
+			if (readMotion(*block, sample.sensor%BlockSize, sample, motion))
+				extrapolate(motion, time, maxPredictionUS, sample);
+			func(sample);
+		});
+	}
+
+	/**
+	 * Sample all sensors that received updates at an arbitrary time in bulk, block by block
+	 */
+	template<typename Func>
+	void forEach(TimePoint_t time, long maxExtrapolationUS, Func &&func) const
+	{
+		forEach([&](Sample &sample)
+		{
+			const Block *block = m_blocks[sample.sensor/BlockSize].load(std::memory_order_acquire);
+			if (sampleHistory(block->history[sample.sensor%BlockSize], time, maxExtrapolationUS, sample))
+				func(sample);
+		});
+	}
+
+	/**
+	 * Read all sensors that received updates in bulk, block by block
+	 */
+	template<typename Func>
+	void forEach(Func &&func) const
+	{
+		int count = sensors();
+		Sample sample;
+		for (int b = 0; b*BlockSize < count; b++)
+		{
+			const Block *block = m_blocks[b].load(std::memory_order_acquire);
+			if (!block) continue;
+			int end = std::min(BlockSize, count - b*BlockSize);
+			for (int i = 0; i < end; i++)
+			{
+				sample.sensor = b*BlockSize + i;
+				if (readBlock(*block, i, sample))
+					func(sample);
+			}
+		}
+	}
+};
+
+#endif // POSE_STORE_H
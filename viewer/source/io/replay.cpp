@@ -0,0 +1,257 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "replay.hpp"
+
+#include "io/vrpn.hpp"
+#include "io/packet_trace.hpp"
+
+#include "util/log.hpp"
+
+
+/*
+ * Replay of capture files
+ */
+
+// Interval in which a paused replay or a replay waiting for new records of a capture still being written checks again
+static const long waitIntervalUS = 10000;
+// Records delivered without checking for control changes when replaying as fast as possible
+static const int batchRecords = 1024;
+
+CaptureReplay::~CaptureReplay()
+{
+	stop();
+}
+
+bool CaptureReplay::open(const std::string &path)
+{
+	if (!m_reader.open(path))
+		return false;
+
+	// Determine time range from first and last valid records
+	Cursor cursor;
+	CaptureRecord record;
+	if (!next(cursor, record))
+	{
+		LOG(LIO, LWarn, "Capture file '%s' does not contain any samples yet!", path.c_str());
+		m_beginUS = 0;
+	}
+	else
+		m_beginUS = record.receivedUS;
+	int64_t endUS = m_beginUS;
+	CaptureChunk info;
+	for (uint32_t c = 0; c < m_reader.chunkCount(); c++)
+	{
+		if (!m_reader.readChunkInfo(c, info)) break;
+		if ((info.flags & Capture::ChunkSealed) && info.records > 0)
+			endUS = std::max(endUS, info.lastUS);
+	}
+	m_endUS = endUS;
+	m_positionUS = m_beginUS;
+	return true;
+}
+
+void CaptureReplay::start(std::unordered_map<uint32_t, vrpn_Tracker_Wrapper*> targets)
+{
+	stop();
+	m_targets = std::move(targets);
+	m_ended = false;
+	m_thread = std::jthread([this](std::stop_token stop_token){ run(stop_token); });
+}
+
+void CaptureReplay::stop()
+{
+	m_thread = {};
+}
+
+std::unique_lock<std::mutex> CaptureReplay::acquire()
+{
+	return std::unique_lock(m_deliverMutex);
+}
+
+CaptureReplay::Controls CaptureReplay::controls()
+{
+	std::unique_lock lock(m_mutex);
+	return m_controls;
+}
+
+void CaptureReplay::setControls(const Controls &controls)
+{
+	std::unique_lock lock(m_mutex);
+	m_controls = controls;
+	m_dirty = true;
+	m_wakeup.notify_all();
+}
+
+void CaptureReplay::seek(int64_t offsetUS)
+{
+	std::unique_lock lock(m_mutex);
+	m_seekUS = m_beginUS + std::max<int64_t>(offsetUS, 0);
+	m_dirty = true;
+	m_wakeup.notify_all();
+}
+
+bool CaptureReplay::next(Cursor &cursor, CaptureRecord &record)
+{
+	while (cursor.chunk < m_reader.chunkCount())
+	{
+		const CaptureRecord *records = m_reader.mapChunk(cursor.chunk);
+		if (!records) return false;
+		for (; cursor.record < Capture::RecordsPerChunk; cursor.record++)
+		{
+			const CaptureRecord &rec = records[cursor.record];
+			uint16_t flags = std::atomic_ref(const_cast<uint16_t&>(rec.flags)).load(std::memory_order_acquire);
+			if (!(flags & Capture::RecordValid))
+			{
+				// Records might still be in the process of being written, only skip them in sealed chunks
+				CaptureChunk info;
+				if (m_reader.readChunkInfo(cursor.chunk, info) && !(info.flags & Capture::ChunkSealed))
+					return false;
+				continue;
+			}
+			record = rec;
+			cursor.record++;
+			return true;
+		}
+		cursor.chunk++;
+		cursor.record = 0;
+	}
+	return false;
+}
+
+CaptureReplay::Cursor CaptureReplay::locate(int64_t timeUS)
+{
+	// Skip whole chunks using their index blocks
+	Cursor cursor;
+	CaptureChunk info;
+	while (m_reader.readChunkInfo(cursor.chunk, info) && (info.flags & Capture::ChunkSealed)
+		&& (info.records == 0 || info.lastUS < timeUS))
+		cursor.chunk++;
+	// Then find first record at or after target time
+	Cursor pos = cursor;
+	CaptureRecord record;
+	while (next(pos, record))
+	{
+		if (record.receivedUS >= timeUS)
+			return cursor;
+		cursor = pos;
+	}
+	return cursor;
+}
+
+void CaptureReplay::run(std::stop_token stop_token)
+{
+	PacketTrace::Writer traceWriter(GetPacketTrace());
+	Cursor cursor;
+	CaptureRecord record;
+	bool pending = false;
+	Controls controls;
+	// Time mapping from capture to now, rebased whenever controls change
+	int64_t baseUS = m_positionUS;
+	TimePoint_t baseTime = sclock::now();
+
+	std::unique_lock lock(m_mutex);
+	while (!stop_token.stop_requested())
+	{
+		if (m_dirty)
+		{
+			if (m_seekUS >= 0)
+			{
+				lock.unlock();
+				cursor = locate(m_seekUS);
+				lock.lock();
+				m_positionUS = m_seekUS;
+				m_seekUS = -1;
+				m_ended = false;
+				pending = false;
+			}
+			controls = m_controls;
+			m_dirty = false;
+			baseUS = m_positionUS;
+			baseTime = sclock::now();
+		}
+		if (controls.paused)
+		{
+			m_wakeup.wait(lock, stop_token, [&]{ return m_dirty; });
+			continue;
+		}
+		lock.unlock();
+
+		std::unique_lock deliverLock(m_deliverMutex);
+		int delivered = 0;
+		while (delivered < batchRecords)
+		{
+			if (!pending && !(pending = next(cursor, record)))
+				break;
+			if (controls.speed > 0)
+			{ // Wait until record is due
+				TimePoint_t due = baseTime + std::chrono::microseconds((int64_t)((record.receivedUS - baseUS) / controls.speed));
+				if (due > sclock::now())
+					break;
+			}
+			auto target = m_targets.find(record.tracker);
+			if (target != m_targets.end())
+			{ // Deliver as if just received, keeping the original latency
+				TimePoint_t received = sclock::now();
+				TimePoint_t timestamp = received - std::chrono::microseconds(record.receivedUS - record.timestampUS);
+				Eigen::Vector3f pos(record.position[0], record.position[1], record.position[2]);
+				Eigen::Quaternionf rot(record.rotation[3], record.rotation[0], record.rotation[1], record.rotation[2]);
+				target->second->deliverPose(record.sensor, pos, rot, timestamp, received);
+				m_samples.fetch_add(1, std::memory_order_relaxed);
+			}
+			m_positionUS = std::max(m_positionUS.load(std::memory_order_relaxed), record.receivedUS);
+			m_endUS = std::max(m_endUS.load(std::memory_order_relaxed), record.receivedUS);
+			pending = false;
+			delivered++;
+		}
+		deliverLock.unlock();
+
+		lock.lock();
+		if (delivered == batchRecords || m_dirty)
+			continue;
+		if (pending)
+		{ // Sleep until next record is due, or controls change
+			TimePoint_t due = baseTime + std::chrono::microseconds((int64_t)((record.receivedUS - baseUS) / controls.speed));
+			m_wakeup.wait_until(lock, stop_token, due, [&]{ return m_dirty; });
+		}
+		else if (!m_reader.finished())
+		{ // Wait for writer to add more records
+			m_wakeup.wait_for(lock, stop_token, std::chrono::microseconds(waitIntervalUS), [&]{ return m_dirty; });
+		}
+		else if (controls.loop)
+		{
+			m_ended = false;
+			cursor = {};
+			m_positionUS = m_beginUS;
+			baseUS = m_beginUS;
+			baseTime = sclock::now();
+		}
+		else
+		{ // Wait for seek or loop to be enabled
+			m_ended = true;
+			m_wakeup.wait(lock, stop_token, [&]{ return m_dirty; });
+		}
+	}
+}
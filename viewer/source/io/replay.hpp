@@ -0,0 +1,108 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "io/capture.hpp"
+
+#include "util/util.hpp" // TimePoint_t
+
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+struct vrpn_Tracker_Wrapper;
+
+/**
+ * Replays a capture file in a dedicated thread, delivering poses to trackers just like their handlers would
+ * Streams records in realtime, at a multiple of realtime, or as fast as possible, with seek, pause and loop
+ * Captures that are still being written are followed until the writer finishes
+ */
+class CaptureReplay
+{
+public:
+	struct Controls
+	{
+		float speed = 1.0f; // 0 for as fast as possible
+		bool paused = false;
+		bool loop = false;
+	};
+
+	~CaptureReplay();
+
+	bool open(const std::string &path);
+	std::vector<CaptureTracker> trackers() const { return m_reader.trackers(); }
+	const std::string &path() const { return m_reader.path(); }
+
+	/**
+	 * Start replaying into the given trackers by id in the capture, which have to outlive the replay
+	 */
+	void start(std::unordered_map<uint32_t, vrpn_Tracker_Wrapper*> targets);
+	void stop();
+
+	/**
+	 * Lock delivery of poses, making the replay thread wait once it delivered its current batch
+	 */
+	std::unique_lock<std::mutex> acquire();
+
+	Controls controls();
+	void setControls(const Controls &controls);
+	void seek(int64_t offsetUS);
+
+	int64_t positionUS() const { return m_positionUS.load(std::memory_order_relaxed) - m_beginUS; }
+	int64_t durationUS() const { return m_endUS.load(std::memory_order_relaxed) - m_beginUS; }
+	bool ended() const { return m_ended.load(std::memory_order_relaxed); }
+	uint64_t samples() const { return m_samples.load(std::memory_order_relaxed); }
+
+private:
+	CaptureReader m_reader; // Only used by replay thread after start
+	std::unordered_map<uint32_t, vrpn_Tracker_Wrapper*> m_targets;
+	int64_t m_beginUS = 0;
+	std::atomic<int64_t> m_endUS = 0, m_positionUS = 0;
+	std::atomic<bool> m_ended = false;
+	std::atomic<uint64_t> m_samples = 0;
+
+	std::mutex m_deliverMutex; // Held by replay thread while delivering poses
+	std::mutex m_mutex;
+	std::condition_variable_any m_wakeup;
+	Controls m_controls;
+	int64_t m_seekUS = -1;
+	bool m_dirty = false;
+	// Declared last so that it is joined before anything else is destroyed
+	std::jthread m_thread;
+
+	struct Cursor
+	{
+		uint32_t chunk = 0, record = 0;
+	};
+	bool next(Cursor &cursor, CaptureRecord &record);
+	Cursor locate(int64_t timeUS);
+	void run(std::stop_token stop_token);
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,226 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "shm_publisher.hpp"
+
+#include "io/clock.hpp"
+
+#include "util/log.hpp"
+
+#include <cstring>
+
+#ifdef __unix__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ * Republishing of poses into shared memory for local consumers
+ */
+
+static std::atomic<ShmPublisher*> ActivePublisher = nullptr;
+ShmPublisher *GetActivePublisher() { return ActivePublisher.load(std::memory_order_acquire); }
+void SetActivePublisher(ShmPublisher *publisher) { ActivePublisher.store(publisher, std::memory_order_release); }
+
+template<typename T>
+static inline void publishField(T &field, T value)
+{ // Fields read by other processes
+	std::atomic_ref<T>(field).store(value, std::memory_order_release);
+}
+
+ShmPublisher::~ShmPublisher()
+{
+	close();
+}
+
+#ifdef __unix__
+
+bool ShmPublisher::open(const std::string &name)
+{
+	close();
+	std::string shmName = name.empty() || name[0] != '/'? "/" + name : name;
+	// Replace any stale segment of a previous run, readers still mapping it simply stop seeing updates
+	shm_unlink(shmName.c_str());
+	int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		LOG(LIO, LError, "Failed to create shared memory '%s': %s", shmName.c_str(), strerror(errno));
+		return false;
+	}
+	std::size_t size = sizeof(at_shm_header)
+		+ sizeof(at_shm_tracker) * AT_SHM_MAX_TRACKERS
+		+ sizeof(at_shm_event) * AT_SHM_EVENT_COUNT;
+	if (ftruncate(fd, size) != 0)
+	{
+		LOG(LIO, LError, "Failed to allocate shared memory '%s': %s", shmName.c_str(), strerror(errno));
+		::close(fd);
+		shm_unlink(shmName.c_str());
+		return false;
+	}
+	void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		LOG(LIO, LError, "Failed to map shared memory '%s': %s", shmName.c_str(), strerror(errno));
+		shm_unlink(shmName.c_str());
+		return false;
+	}
+	m_name = shmName;
+	m_shm = (uint8_t*)map;
+	m_size = size;
+	// Freshly truncated, so already zeroed
+	m_header = (at_shm_header*)m_shm;
+	m_trackers = (at_shm_tracker*)(m_shm + sizeof(at_shm_header));
+	m_events = (at_shm_event*)(m_shm + sizeof(at_shm_header) + sizeof(at_shm_tracker) * AT_SHM_MAX_TRACKERS);
+	m_header->version = AT_SHM_VERSION;
+	m_header->header_size = sizeof(at_shm_header);
+	m_header->tracker_size = sizeof(at_shm_tracker);
+	m_header->pose_size = sizeof(at_shm_pose);
+	m_header->event_size = sizeof(at_shm_event);
+	m_header->max_trackers = AT_SHM_MAX_TRACKERS;
+	m_header->max_sensors = AT_SHM_MAX_SENSORS;
+	m_header->event_count = AT_SHM_EVENT_COUNT;
+	m_header->tracker_offset = (uint8_t*)m_trackers - m_shm;
+	m_header->event_offset = (uint8_t*)m_events - m_shm;
+	m_header->writer_pid = getpid();
+	m_header->start_us = GetClockSync().toSystemUS(sclock::now());
+	m_header->open = 1;
+	// Readers only accept the segment once the magic is set
+	publishField(m_header->magic, AT_SHM_MAGIC);
+	LOG(LIO, LInfo, "Publishing poses into shared memory '%s'!", shmName.c_str());
+	return true;
+}
+
+void ShmPublisher::close()
+{
+	if (!m_shm) return;
+	// Expects no more writes
+	publishField(m_header->open, 0u);
+	munmap(m_shm, m_size);
+	shm_unlink(m_name.c_str());
+	m_shm = nullptr;
+	m_header = nullptr;
+	m_trackers = nullptr;
+	m_events = nullptr;
+}
+
+#else
+
+bool ShmPublisher::open(const std::string &name)
+{
+	LOG(LIO, LError, "Shared memory publishing is not supported on this platform!");
+	return false;
+}
+
+void ShmPublisher::close() {}
+
+#endif
+
+void ShmPublisher::setTracker(uint32_t slot, uint32_t id, const std::string &path)
+{
+	if (!m_shm || slot >= AT_SHM_MAX_TRACKERS) return;
+	at_shm_tracker &tracker = m_trackers[slot];
+	// Descriptor and poses are protected by the sequence lock of the tracker and its poses respectively
+	uint32_t seq = std::atomic_ref(tracker.sequence).load(std::memory_order_relaxed);
+	std::atomic_ref(tracker.sequence).store(seq+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	tracker.id = id;
+	tracker.active = 1;
+	std::memset(tracker.path, 0, sizeof(tracker.path));
+	std::strncpy(tracker.path, path.c_str(), sizeof(tracker.path)-1);
+	std::atomic_ref(tracker.sequence).store(seq+2, std::memory_order_release);
+}
+
+void ShmPublisher::clearTracker(uint32_t slot)
+{
+	if (!m_shm || slot >= AT_SHM_MAX_TRACKERS) return;
+	at_shm_tracker &tracker = m_trackers[slot];
+	uint32_t seq = std::atomic_ref(tracker.sequence).load(std::memory_order_relaxed);
+	std::atomic_ref(tracker.sequence).store(seq+1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	tracker.active = 0;
+	tracker.sensors = 0;
+	// Invalidate poses so they are not attributed to the next tracker assigned this slot
+	for (at_shm_pose &pose : tracker.poses)
+	{
+		uint32_t poseSeq = std::atomic_ref(pose.sequence).load(std::memory_order_relaxed);
+		std::atomic_ref(pose.sequence).store(poseSeq+1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		pose.sensor = 0;
+		pose.timestamp_us = pose.received_us = 0;
+		std::memset(pose.position, 0, sizeof(pose.position));
+		std::memset(pose.rotation, 0, sizeof(pose.rotation));
+		std::atomic_ref(pose.sequence).store(poseSeq+2, std::memory_order_release);
+	}
+	std::atomic_ref(tracker.sequence).store(seq+2, std::memory_order_release);
+}
+
+void ShmPublisher::publish(uint32_t slot, uint32_t id, int sensor, const Eigen::Vector3f &pos, const Eigen::Quaternionf &rot,
+	TimePoint_t timestamp, TimePoint_t received)
+{
+	if (!m_shm) return;
+	int64_t timestampUS = GetClockSync().toSystemUS(timestamp), receivedUS = GetClockSync().toSystemUS(received);
+
+	if (slot < AT_SHM_MAX_TRACKERS && sensor >= 0 && sensor < AT_SHM_MAX_SENSORS)
+	{ // Latest pose in tracker table
+		at_shm_tracker &tracker = m_trackers[slot];
+		at_shm_pose &pose = tracker.poses[sensor];
+		uint32_t seq = std::atomic_ref(pose.sequence).load(std::memory_order_relaxed);
+		std::atomic_ref(pose.sequence).store(seq+1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		pose.sensor = sensor;
+		pose.timestamp_us = timestampUS;
+		pose.received_us = receivedUS;
+		std::memcpy(pose.position, pos.data(), sizeof(pose.position));
+		std::memcpy(pose.rotation, rot.coeffs().data(), sizeof(pose.rotation));
+		std::atomic_ref(pose.sequence).store(seq+2, std::memory_order_release);
+		if (std::atomic_ref(tracker.sensors).load(std::memory_order_relaxed) <= (uint32_t)sensor)
+			std::atomic_ref(tracker.sensors).store(sensor+1, std::memory_order_release);
+	}
+
+	{ // Every pose in event ring
+		uint64_t index = std::atomic_ref(m_header->event_head).fetch_add(1, std::memory_order_relaxed);
+		at_shm_event &event = m_events[index % AT_SHM_EVENT_COUNT];
+		std::atomic_ref(event.sequence).store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		event.tracker = id;
+		event.sensor = sensor;
+		event.timestamp_us = timestampUS;
+		event.received_us = receivedUS;
+		std::memcpy(event.position, pos.data(), sizeof(event.position));
+		std::memcpy(event.rotation, rot.coeffs().data(), sizeof(event.rotation));
+		event.slot = slot < AT_SHM_MAX_TRACKERS? slot : UINT32_MAX;
+		std::atomic_ref(event.sequence).store(index+1, std::memory_order_release);
+	}
+}
+
+uint64_t ShmPublisher::events() const
+{
+	if (!m_shm) return 0;
+	return std::atomic_ref(m_header->event_head).load(std::memory_order_relaxed);
+}
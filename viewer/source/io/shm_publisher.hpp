@@ -0,0 +1,86 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SHM_PUBLISHER_H
+#define SHM_PUBLISHER_H
+
+#include "util/eigendef.hpp"
+#include "util/util.hpp" // TimePoint_t
+
+#include "pose_shm.h"
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Republishes all received poses into a POSIX shared memory segment (layout in shared/pose_shm.h)
+ * Any number of local processes can then read the latest or buffered poses without copies or syscalls
+ * Poses of each tracker are published by the single thread feeding it, events by any number of threads
+ */
+class ShmPublisher
+{
+public:
+	ShmPublisher() {}
+	~ShmPublisher();
+
+	bool open(const std::string &name);
+	void close();
+	bool isOpen() const { return m_shm != nullptr; }
+	const std::string &name() const { return m_name; }
+
+	/**
+	 * Assign tracker table slot to a tracker, or clear it along with its poses (io.mutex held)
+	 * Expects no more poses to be published into a slot while it is cleared
+	 */
+	void setTracker(uint32_t slot, uint32_t id, const std::string &path);
+	void clearTracker(uint32_t slot);
+
+	/**
+	 * Publish a pose of a tracker, from the single thread feeding the tracker
+	 * Slot may exceed the tracker table, then it is only published as an event
+	 */
+	void publish(uint32_t slot, uint32_t id, int sensor, const Eigen::Vector3f &pos, const Eigen::Quaternionf &rot,
+		TimePoint_t timestamp, TimePoint_t received);
+
+	uint64_t events() const;
+
+private:
+	std::string m_name;
+	uint8_t *m_shm = nullptr;
+	std::size_t m_size = 0;
+	at_shm_header *m_header = nullptr;
+	at_shm_tracker *m_trackers = nullptr;
+	at_shm_event *m_events = nullptr;
+};
+
+/**
+ * Publisher the receiving threads republish into, if any
+ * Changes only become visible to receiving threads once they passed their lock
+ */
+ShmPublisher *GetActivePublisher();
+void SetActivePublisher(ShmPublisher *publisher);
+
+#endif // SHM_PUBLISHER_H
@@ -0,0 +1,149 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "stream_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+int StreamStats::bucketIndex(long valueUS)
+{
+	if (valueUS < SubBuckets) return std::max<long>(valueUS, 0);
+	int exp = std::bit_width((unsigned long)valueUS)-1;
+	int index = (exp-2)*SubBuckets + ((valueUS >> (exp-3)) & (SubBuckets-1));
+	return std::min(index, LatencyBuckets-1);
+}
+
+long StreamStats::bucketValue(int index)
+{
+	if (index < SubBuckets) return index;
+	int exp = index/SubBuckets + 2;
+	long lower = (long)(SubBuckets + index%SubBuckets) << (exp-3);
+	return lower + ((1l << (exp-3)) >> 1);
+}
+
+long StreamStats::percentile(uint64_t total, float fraction) const
+{
+	uint64_t target = std::ceil(total * fraction), count = 0;
+	for (int i = 0; i < LatencyBuckets; i++)
+	{
+		count += m_latency[i];
+		if (count >= target && count > 0)
+			return bucketValue(i);
+	}
+	return 0;
+}
+
+void StreamStats::record(TimePoint_t timestamp, TimePoint_t received)
+{
+	if (m_windowStart == TimePoint_t())
+		m_windowStart = received;
+	m_windowPackets++;
+
+	long latencyUS = dtUS(timestamp, received);
+	if (latencyUS < 0)
+	{ // Server clock is ahead, only happens without clock sync
+		m_windowNegative++;
+		latencyUS = 0;
+	}
+	m_latency[bucketIndex(latencyUS)]++;
+	m_windowMaxUS = std::max(m_windowMaxUS, latencyUS);
+
+	if (m_frames == 0 || timestamp != m_lastTimestamp)
+	{ // New frame
+		if (m_frames > 0)
+		{
+			long intervalUS = dtUS(m_lastFrame, received);
+			if (intervalUS >= DropoutUS)
+				m_dropouts++;
+			else if (m_expectedUS > 0 && intervalUS > m_expectedUS*GapFactor)
+				m_gaps++;
+			else
+			{ // Welford's online mean and variance
+				m_intervals++;
+				double delta = intervalUS - m_intervalMean;
+				m_intervalMean += delta / m_intervals;
+				m_intervalM2 += delta * (intervalUS - m_intervalMean);
+			}
+		}
+		m_lastFrame = received;
+		m_lastTimestamp = timestamp;
+		m_frames++;
+		m_windowFrames++;
+	}
+
+	if (dtUS(m_windowStart, received) >= WindowUS)
+		publish(received);
+}
+
+StreamStats::Snapshot StreamStats::read(TimePoint_t now) const
+{
+	Snapshot snapshot = m_snapshot.read();
+	if (snapshot.updated == TimePoint_t() || dtUS(snapshot.updated, now) <= WindowUS)
+		return snapshot;
+	// Next window would have completed with the first packet after it, so none arrived since
+	snapshot.stalled = true;
+	snapshot.frameRate = snapshot.packetRate = 0;
+	snapshot.dropouts++; // Will be counted by the writer once packets resume
+	return snapshot;
+}
+
+void StreamStats::publish(TimePoint_t now)
+{
+	float elapsedS = dtUS(m_windowStart, now) / 1000000.0f;
+	if (m_intervals > 0)
+		m_expectedUS = std::lround(m_intervalMean);
+
+	uint64_t total = 0;
+	for (uint32_t count : m_latency)
+		total += count;
+
+	m_snapshot.update([&](Snapshot &snapshot)
+	{
+		snapshot.updated = now;
+		snapshot.frameRate = m_windowFrames / elapsedS;
+		snapshot.packetRate = m_windowPackets / elapsedS;
+		snapshot.intervalMS = m_intervalMean / 1000.0f;
+		snapshot.jitterMS = m_intervals > 1? std::sqrt(m_intervalM2 / (m_intervals-1)) / 1000.0f : 0.0f;
+		snapshot.latencyP50MS = percentile(total, 0.50f) / 1000.0f;
+		snapshot.latencyP90MS = percentile(total, 0.90f) / 1000.0f;
+		snapshot.latencyP99MS = percentile(total, 0.99f) / 1000.0f;
+		snapshot.latencyMaxMS = m_windowMaxUS / 1000.0f;
+		snapshot.negativeLatency = m_windowNegative;
+		snapshot.gaps = m_gaps;
+		snapshot.dropouts = m_dropouts;
+		snapshot.frames = m_frames;
+	});
+
+	// Decay histogram so percentiles follow the recent stream while still smoothing over a few windows
+	for (uint32_t &count : m_latency)
+		count /= 2;
+	m_windowStart = now;
+	m_windowPackets = m_windowFrames = m_windowNegative = 0;
+	m_windowMaxUS = 0;
+	m_intervals = 0;
+	m_intervalMean = m_intervalM2 = 0;
+}
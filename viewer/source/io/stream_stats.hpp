@@ -0,0 +1,100 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include "util/util.hpp" // TimePoint_t
+#include "util/seqlock.hpp"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Rolling statistics of the packet stream of a single tracker
+ * Updated incrementally by the thread feeding the tracker with every packet, without allocations or locking
+ * Packets with the same server timestamp (e.g. multiple sensors or velocity alongside a pose) count as one frame
+ * - Frame and packet rate over the last window
+ * - Inter-arrival jitter as the standard deviation of frame intervals (Welford), excluding gaps
+ * - Gaps (frame interval exceeding GapFactor times the expected interval) and dropouts (exceeding DropoutUS)
+ * - Latency percentiles from a log-linear histogram with fixed buckets, decaying each window
+ * A snapshot is published at the end of each window for any thread to read without locking
+ * Windows only end when packets arrive, so readers mark snapshots of a stream that stopped as stalled
+ */
+class StreamStats
+{
+public:
+	static const long WindowUS = 1000000;
+	static const long DropoutUS = 250000;
+	static constexpr float GapFactor = 3.0f;
+	// Log-linear latency buckets, exact below 8us, then 8 buckets per power of two up to ~2s (~12% resolution)
+	static const int SubBuckets = 8;
+	static const int LatencyBuckets = SubBuckets*19;
+
+	struct Snapshot
+	{
+		TimePoint_t updated = {}; // Default if no window was completed yet
+		float frameRate = 0, packetRate = 0;
+		float intervalMS = 0, jitterMS = 0;
+		float latencyP50MS = 0, latencyP90MS = 0, latencyP99MS = 0, latencyMaxMS = 0;
+		uint32_t negativeLatency = 0; // Packets received before their timestamp in the last window, clocks are not synced
+		uint32_t gaps = 0, dropouts = 0; // Since the stream started
+		uint64_t frames = 0;
+		bool stalled = false; // No packets for over a window, rates are zero and the ongoing dropout is counted
+	};
+
+private:
+	// Writer state, only accessed by the thread feeding the tracker
+	TimePoint_t m_windowStart = {}, m_lastFrame = {}, m_lastTimestamp = {};
+	uint32_t m_windowPackets = 0, m_windowFrames = 0, m_windowNegative = 0;
+	long m_windowMaxUS = 0;
+	long m_expectedUS = 0; // Mean frame interval of the last window, 0 if unknown
+	// Welford accumulators of frame intervals in the current window
+	uint32_t m_intervals = 0;
+	double m_intervalMean = 0, m_intervalM2 = 0;
+	std::array<uint32_t, LatencyBuckets> m_latency = {};
+	uint32_t m_gaps = 0, m_dropouts = 0;
+	uint64_t m_frames = 0;
+
+	SeqLock<Snapshot> m_snapshot;
+
+	static int bucketIndex(long valueUS);
+	static long bucketValue(int index);
+	long percentile(uint64_t total, float fraction) const;
+	void publish(TimePoint_t now);
+
+public:
+	/**
+	 * Account a received packet (writer thread only)
+	 */
+	void record(TimePoint_t timestamp, TimePoint_t received);
+
+	/**
+	 * Latest snapshot, completed at the end of the last window, or marked stalled if that is over a window ago (any thread)
+	 */
+	Snapshot read(TimePoint_t now = sclock::now()) const;
+};
+
+#endif // STREAM_STATS_H
@@ -27,6 +27,11 @@ SOFTWARE.
 
 #include "vrpn/quat.h"
 
+#include "io/clock.hpp"
+#include "io/packet_trace.hpp"
+#include "io/capture.hpp"
+#include "io/shm_publisher.hpp"
+
 #include "util/log.hpp"
 
 
@@ -43,99 +48,151 @@ template<> void OpaqueDeleter<vrpn_Connection>::operator()(vrpn_Connection* ptr)
 
 /* Conversion from internally used steady_clock to timeval used by VRPN */
 
+// Single add using the clock estimate instead of sampling both clocks for every packet
+
 static inline struct timeval createTimestamp(TimePoint_t time)
 {
-	// Create timestamp without assuming steady_clock to be equivalent to timeval
-	struct timeval time_now, timestamp;
-	vrpn_gettimeofday(&time_now, NULL);
-	TimePoint_t time_ref = sclock::now();
-	long diffUS = std::chrono::duration_cast<std::chrono::microseconds>(time_ref - time).count();
-	long long timeUS = time_now.tv_sec * 1000000 + time_now.tv_usec;
-	timeUS -= diffUS;
+	long long timeUS = GetClockSync().toSystemUS(time);
+	struct timeval timestamp;
 	timestamp.tv_sec = timeUS/1000000;
 	timestamp.tv_usec = timeUS%1000000;
-	LOG(LIO, LTrace, "Time %.2fms ago resulted in timestamp (%ld, %ld) from cur time (%ld, %ld) and diff (%ldus)",
-		std::chrono::duration_cast<std::chrono::microseconds>(time_ref - time).count()/1000.0f,
-		timestamp.tv_sec, timestamp.tv_usec, time_now.tv_sec, time_now.tv_usec, diffUS)
 	return timestamp;
 }
 
-static inline TimePoint_t getTimestamp(struct timeval time_msg)
+static inline TimePoint_t getTimestamp(struct timeval time_msg, long long remoteOffsetUS = 0)
 {
-	// Recreate timestamp without assuming steady_clock to be equivalent to timeval
-	struct timeval time_now;
-	vrpn_gettimeofday(&time_now, NULL);
-	TimePoint_t timestamp = sclock::now();
-	timestamp -= std::chrono::seconds(time_now.tv_sec-time_msg.tv_sec);
-	timestamp -= std::chrono::microseconds(time_now.tv_usec-time_msg.tv_usec);
-	return timestamp;
+	// Remote offset maps from system clock of the server to local system clock
+	long long timeUS = (long long)time_msg.tv_sec * 1000000 + time_msg.tv_usec + remoteOffsetUS;
+	return GetClockSync().fromSystemUS(timeUS);
 }
 
 
 /* Wrapper for a VRPN remote tracker */
 
+template<typename Scalar>
+static inline void tracePacket(vrpn_Tracker_Wrapper *tracker, PacketRecord::Type type, int sensor,
+	TimePoint_t timestamp, TimePoint_t received, const Scalar vec[3], const Scalar quat[4])
+{ // Quaternion in x, y, z, w order like both VRPN and Eigen use
+	PacketRecord record;
+	record.type = type;
+	record.sensor = sensor;
+	record.tracker = tracker->id;
+	record.timestamp = timestamp;
+	record.received = received;
+	for (int i = 0; i < 3; i++) record.vec[i] = vec[i];
+	for (int i = 0; i < 4; i++) record.quat[i] = quat[i];
+	GetPacketTrace().record(record);
+}
+
 static void handleTrackerPosRot(void *data, const vrpn_TRACKERCB t)
 {
 	vrpn_Tracker_Wrapper *tracker = (vrpn_Tracker_Wrapper*)data;
-	tracker->lastTimestamp = getTimestamp(t.msg_time);
-	tracker->lastPacket = sclock::now();
-	tracker->receivedPackets = true;
-
-	if (tracker->logPackets)
-	{
-		LOG(LIO, LInfo, "Tracker %s, sensor %d pose update!", tracker->path.c_str(), t.sensor);
-		LOG(LIO, LInfo, "Pos: (%f, %f, %f)", t.pos[0], t.pos[1], t.pos[2]);
-		LOG(LIO, LInfo, "Rot: (%f, %f, %f, %f)", t.quat[0], t.quat[1], t.quat[2], t.quat[3]);
-	}
+	TimePoint_t timestamp = getTimestamp(t.msg_time, tracker->receiver->remoteOffsetUS.load(std::memory_order_relaxed));
+	Eigen::Vector3f pos = Eigen::Vector3d(t.pos[0], t.pos[1], t.pos[2]).cast<float>();
+	Eigen::Quaternionf rot = Eigen::Quaterniond(t.quat[Q_W], t.quat[Q_X], t.quat[Q_Y], t.quat[Q_Z]).cast<float>();
+	tracker->deliverPose(t.sensor, pos, rot, timestamp, sclock::now());
+}
 
-	Eigen::Vector3d pos = Eigen::Vector3d(t.pos[0], t.pos[1], t.pos[2]);
-	Eigen::Matrix3d rot = Eigen::Quaterniond(t.quat[Q_W], t.quat[Q_X], t.quat[Q_Y], t.quat[Q_Z]).toRotationMatrix();
-	Eigen::Isometry3f pose;
-	pose.linear() = rot.cast<float>();
-	pose.translation() = pos.cast<float>();
-	tracker->pose = pose;
+// Angular rate (world space axis * angle per second) from a VRPN quaternion rotating over dt seconds
+static inline Eigen::Vector3f getAngularRate(const vrpn_float64 quat[4], vrpn_float64 dt)
+{
+	if (dt <= 0) return Eigen::Vector3f::Zero();
+	Eigen::Quaterniond rot(quat[Q_W], quat[Q_X], quat[Q_Y], quat[Q_Z]);
+	if (rot.w() < 0) rot.coeffs() = -rot.coeffs();
+	Eigen::AngleAxisd aa(rot.normalized());
+	return (aa.axis() * aa.angle() / dt).cast<float>();
 }
 
 static void handleTrackerVelocity(void *data, const vrpn_TRACKERVELCB t)
 { // Currently not sent by AsterTrack
 	vrpn_Tracker_Wrapper *tracker = (vrpn_Tracker_Wrapper*)data;
-	tracker->lastTimestamp = getTimestamp(t.msg_time);
-	tracker->lastPacket = sclock::now();
-	tracker->receivedPackets = true;
-
-	if (tracker->logPackets)
+	TimePoint_t timestamp = getTimestamp(t.msg_time, tracker->receiver->remoteOffsetUS.load(std::memory_order_relaxed));
+	TimePoint_t received = sclock::now();
+	Eigen::Vector3f vel = Eigen::Vector3d(t.vel[0], t.vel[1], t.vel[2]).cast<float>();
+	tracker->sensors.writeVelocity(t.sensor, vel, getAngularRate(t.vel_quat, t.vel_quat_dt), timestamp);
+	tracker->published.update([&](auto &pub)
 	{
-		LOG(LIO, LInfo, "Tracker %s, sensor %d velocity update!", tracker->path.c_str(), t.sensor);
-		LOG(LIO, LInfo, "dT: (%f, %f, %f)", t.vel[0], t.vel[1], t.vel[2]);
-		LOG(LIO, LInfo, "dR: (%f, %f, %f, %f)", t.vel_quat[0], t.vel_quat[1], t.vel_quat[2], t.vel_quat[3]);
-	}
+		pub.lastTimestamp = timestamp;
+		pub.lastPacket = received;
+		pub.packets++;
+	});
+	tracker->stats.record(timestamp, received);
+
+	if (tracker->tracePackets)
+		tracePacket(tracker, PacketRecord::Velocity, t.sensor, timestamp, received, t.vel, t.vel_quat);
 }
 
 static void handleTrackerAccel(void *data, const vrpn_TRACKERACCCB t)
 { // Currently not sent by AsterTrack
 	vrpn_Tracker_Wrapper *tracker = (vrpn_Tracker_Wrapper*)data;
-	tracker->lastTimestamp = getTimestamp(t.msg_time);
-	tracker->lastPacket = sclock::now();
-	tracker->receivedPackets = true;
+	TimePoint_t timestamp = getTimestamp(t.msg_time, tracker->receiver->remoteOffsetUS.load(std::memory_order_relaxed));
+	TimePoint_t received = sclock::now();
+	Eigen::Vector3f acc = Eigen::Vector3d(t.acc[0], t.acc[1], t.acc[2]).cast<float>();
+	tracker->sensors.writeAcceleration(t.sensor, acc, getAngularRate(t.acc_quat, t.acc_quat_dt), timestamp);
+	tracker->published.update([&](auto &pub)
+	{
+		pub.lastTimestamp = timestamp;
+		pub.lastPacket = received;
+		pub.packets++;
+	});
+	tracker->stats.record(timestamp, received);
+
+	if (tracker->tracePackets)
+		tracePacket(tracker, PacketRecord::Accel, t.sensor, timestamp, received, t.acc, t.acc_quat);
+}
+
+void vrpn_Tracker_Wrapper::deliverPose(int sensor, const Eigen::Vector3f &pos, const Eigen::Quaternionf &rot,
+	TimePoint_t timestamp, TimePoint_t received)
+{
+	if (tracePackets)
+		tracePacket(this, PacketRecord::Pose, sensor, timestamp, received, pos.data(), rot.coeffs().data());
+
+	if (!sensors.write(sensor, pos, rot, timestamp, received))
+	{
+		LOG(LIO, LWarn, "Tracker %s sent pose of sensor %d, exceeding max sensor id of %d!", path.c_str(), sensor, PoseStore::MaxSensors-1);
+	}
+	else
+	{
+		if (CaptureWriter *capture = GetActiveCapture())
+			capture->record(id, sensor, pos, rot, timestamp, received);
+		if (ShmPublisher *publisher = GetActivePublisher())
+			publisher->publish(handle.index, id, sensor, pos, rot, timestamp, received);
+	}
+	published.update([&](auto &pub)
+	{
+		pub.lastTimestamp = timestamp;
+		pub.lastPacket = received;
+		pub.packets++;
+	});
+	stats.record(timestamp, received);
+}
 
-	if (tracker->logPackets)
+const char *TrackerStatusName(TrackerStatus status)
+{
+	switch (status)
 	{
-		LOG(LIO, LInfo, "Tracker %s, sensor %d accel update!", tracker->path.c_str(), t.sensor);
-		LOG(LIO, LInfo, "ddT: (%f, %f, %f)", t.acc[0], t.acc[1], t.acc[2]);
-		LOG(LIO, LInfo, "ddR: (%f, %f, %f, %f)", t.acc_quat[0], t.acc_quat[1], t.acc_quat[2], t.acc_quat[3]);
+		case TrackerStatus::Idle: return "Idle";
+		case TrackerStatus::Searching: return "Searching";
+		case TrackerStatus::Connected: return "Connected";
+		case TrackerStatus::Tracking: return "Tracking";
+		case TrackerStatus::Lost: return "Lost";
 	}
+	return "Unknown";
 }
 
-vrpn_Tracker_Wrapper::vrpn_Tracker_Wrapper(std::string Path)
+vrpn_Tracker_Wrapper::vrpn_Tracker_Wrapper(std::string Path, float LookaheadMS)
+	: lookaheadMS(LookaheadMS)
 {
+	static std::atomic<uint32_t> nextID = 0;
+	id = nextID++;
 	path = std::move(Path);
 	if (path.find('@') == path.npos)
 		path += "@localhost";
 }
 
-void vrpn_Tracker_Wrapper::connect()
+void vrpn_Tracker_Wrapper::connect(vrpn_Connection *connection)
 {
-	remote = std::make_unique<vrpn_Tracker_Remote>(path.c_str());
+	remote = std::make_unique<vrpn_Tracker_Remote>(path.c_str(), connection);
 	remote->register_change_handler(this, handleTrackerPosRot);
 	remote->register_change_handler(this, handleTrackerVelocity);
 	remote->register_change_handler(this, handleTrackerAccel);
@@ -152,20 +209,235 @@ bool vrpn_Tracker_Wrapper::isConnected()
 	return diff.tv_sec < 3;
 }
 
-std::vector<std::string> vrpn_getKnownTrackers(vrpn_Connection *connection)
+
+/* Receiver of a VRPN connection */
+
+vrpn_Receiver::vrpn_Receiver(opaque_ptr<vrpn_Connection> &&Connection, vrpn_Worker &Worker)
+	: connection(std::move(Connection))
 {
-	std::vector<std::string> trackers;
+	discoverySnapshot = std::make_shared<Discovery>();
+	Worker.adopt(*this);
+}
+
+vrpn_Receiver::~vrpn_Receiver()
+{
+	if (!worker) return;
+	auto lock = worker->acquire();
+	std::erase(worker->receivers, this);
+	clock = nullptr;
+}
 
+static void handleClockSync(void *data, const vrpn_CLOCKCB info)
+{
+	vrpn_Receiver *receiver = (vrpn_Receiver*)data;
+	// vrpn_CLOCKCB::tvClockOffset is documented in vrpn_Clock.h as "Local time - remote time",
+	// vrpn_Clock_Remote computing it from the local receive time minus the server time echoed in the reply,
+	// corrected by half the round trip. So remote + offset maps server timestamps to local time in getTimestamp
+	receiver->remoteOffsetUS = (long long)info.tvClockOffset.tv_sec * 1000000 + info.tvClockOffset.tv_usec;
+	receiver->remoteRoundTripUS = 2 * ((long long)info.tvHalfRoundTrip.tv_sec * 1000000 + info.tvHalfRoundTrip.tv_usec);
+}
+
+void vrpn_Receiver::syncClock(const std::string &clockPath)
+{
+	auto lock = acquire();
+	if (clock)
+		clock->unregister_clock_sync_handler(this, handleClockSync);
+	clock = nullptr;
+	remoteOffsetUS = 0;
+	remoteRoundTripUS = -1;
+	if (clockPath.empty()) return;
+	// Resolves to the same connection by name
+	clock = std::make_unique<vrpn_Clock_Remote>(clockPath.c_str());
+	clock->register_clock_sync_handler(this, handleClockSync);
+}
+
+std::unique_lock<std::mutex> vrpn_Receiver::acquire()
+{
+	return worker->acquire();
+}
+
+void vrpn_Receiver::attach(vrpn_Tracker_Wrapper &tracker)
+{
+	auto lock = acquire();
+	tracker.connect(connection.get());
+	tracker.receiver = this;
+	trackers.push_back(&tracker);
+	worker->notify();
+}
+
+void vrpn_Receiver::detach(vrpn_Tracker_Wrapper &tracker)
+{
+	auto lock = acquire();
+	std::erase(trackers, &tracker);
+	tracker.remote = nullptr;
+	tracker.receiver = nullptr;
+}
+
+unsigned int vrpn_Receiver::countPackets() const
+{
+	unsigned int packets = 0;
+	for (auto *tracker : trackers)
+		packets += tracker->published.sequence()/2;
+	return packets;
+}
+
+void vrpn_Receiver::service(long timeoutUS)
+{
+	struct timeval timeout = { 0, timeoutUS };
+	connection->mainloop(&timeout);
+	for (auto *tracker : trackers) // Only to handle pings, connection has already been serviced
+		tracker->remote->mainloop();
+	if (clock) clock->mainloop();
+	lastService = sclock::now();
+	discover();
+}
+
+void vrpn_Receiver::discover()
+{
+	// Senders are only ever added, so probing the next index is enough to detect changes
 	// Sadly, this uses d_dispatcher, which does not differentiate between local and remote sender name
 	// d_senders of an endpoint in d_endpoints might have more differentiating info (e.g. assigned remote id)
 	// but these are all protected members
+	if (!connection->sender_name(knownSenders+1)) return;
+	auto snapshot = std::make_shared<Discovery>();
 	int i = 1;
-	while (true)
+	while (const char *senderName = connection->sender_name(i))
+	{
+		snapshot->senders.emplace_back(senderName);
+		i++;
+	}
+	knownSenders = i-1;
+	snapshot->generation = discoveryGen.load(std::memory_order_relaxed)+1;
 	{
-		const char *senderName = connection->sender_name(i++);
-		if (!senderName) break;
-		trackers.emplace_back(senderName);
+		auto lock = std::unique_lock(discoveryMutex);
+		discoverySnapshot = std::move(snapshot);
 	}
+	discoveryGen.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<const vrpn_Receiver::Discovery> vrpn_Receiver::discovery() const
+{
+	auto lock = std::unique_lock(discoveryMutex);
+	return discoverySnapshot;
+}
+
+
+/* Receiving thread servicing multiple VRPN connections */
+
+// Upper bound for blocking in the connections select, and thus for how long attaching/detaching may be delayed
+static const long receiveTimeoutUS = 10000;
+// Slice of blocking in the select of each connection in turn when sharing the worker with other active connections
+// Bounds how long packets of the others wait, at the cost of waking up more often
+static const long sharedSliceUS = 500;
+// Interval in which a connection without trackers or without a server is serviced (e.g. for reconnecting)
+static const long idleIntervalUS = 100000;
+// Interval in which load statistics are updated
+static const long statsIntervalUS = 1000000;
 
-	return trackers;
+vrpn_Worker::vrpn_Worker(int Index) : index(Index)
+{
+	thread = std::jthread([this](std::stop_token stop_token){ run(stop_token); });
+}
+
+std::unique_lock<std::mutex> vrpn_Worker::acquire()
+{
+	pending++;
+	std::unique_lock lock(mutex);
+	pending--;
+	return lock;
+}
+
+void vrpn_Worker::adopt(vrpn_Receiver &receiver)
+{
+	if (receiver.worker == this) return;
+	vrpn_Worker *previous = receiver.worker;
+	// Lock in consistent order to prevent deadlocks when moving between workers in both directions
+	std::unique_lock<std::mutex> lockA, lockB;
+	if (previous && previous->index < index)
+		lockA = previous->acquire();
+	lockB = acquire();
+	if (previous && previous->index > index)
+		lockA = previous->acquire();
+	if (previous)
+		std::erase(previous->receivers, &receiver);
+	receivers.push_back(&receiver);
+	receiver.worker = this;
+	notify();
+}
+
+void vrpn_Worker::notify()
+{
+	dirty = true;
+	wakeup.notify_all();
+}
+
+void vrpn_Worker::run(std::stop_token stop_token)
+{
+	PacketTrace::Writer traceWriter(GetPacketTrace());
+	std::vector<vrpn_Receiver*> active;
+	std::size_t next = 0;
+	TimePoint_t lastStats = sclock::now();
+	unsigned int lastPackets = 0;
+	std::unique_lock lock(mutex);
+	while (!stop_token.stop_requested())
+	{
+		if (pending.load() > 0)
+		{ // Let other threads attach/detach trackers first
+			lock.unlock();
+			while (pending.load() > 0)
+				std::this_thread::yield();
+			lock.lock();
+			continue;
+		}
+
+		TimePoint_t now = sclock::now();
+		active.clear();
+		int trackers = 0;
+		for (auto *receiver : receivers)
+		{
+			trackers += receiver->trackers.size();
+			if (receiver->isActive())
+				active.push_back(receiver);
+			else if (dtUS(receiver->lastService, now) >= idleIntervalUS)
+				receiver->service(0);
+		}
+		dirty = false;
+
+		if (dtUS(lastStats, now) >= statsIntervalUS)
+		{
+			unsigned int packets = 0;
+			for (auto *receiver : receivers)
+				packets += receiver->countPackets();
+			// Packet counts of detached trackers are lost, so this might be off for one interval
+			packetRate = std::max<int>(packets - lastPackets, 0) * 1000000.0f / dtUS(lastStats, now);
+			trackerCount = trackers;
+			activeCount = active.size();
+			lastPackets = packets;
+			lastStats = now;
+		}
+
+		if (active.empty())
+		{ // Wake up as soon as trackers are attached or idle connections are due to be serviced
+			wakeup.wait_for(lock, stop_token, std::chrono::microseconds(receivers.empty()? statsIntervalUS : idleIntervalUS), [&]{ return dirty; });
+			continue;
+		}
+
+		if (active.size() == 1)
+		{ // Block until packets arrive and dispatch them to the trackers handlers
+			active.front()->service(receiveTimeoutUS);
+			continue;
+		}
+
+		// Poll all active connections, and only block if none had packets waiting
+		bool received = false;
+		for (auto *receiver : active)
+		{
+			unsigned int packets = receiver->countPackets();
+			receiver->service(0);
+			received |= receiver->countPackets() != packets;
+		}
+		if (received) continue;
+		// Block in each connection in turn for a short slice, so packets of the others are not delayed much
+		active[next++ % active.size()]->service(sharedSliceUS);
+	}
 }
@@ -29,34 +29,197 @@ SOFTWARE.
 #include "util/eigendef.hpp"
 #include "util/util.hpp" // TimePoint_t
 #include "util/memory.hpp" // unique_ptr, opaque_ptr
+#include "util/seqlock.hpp"
+#include "util/slot_map.hpp"
+
+#include "io/pose_store.hpp"
+#include "io/stream_stats.hpp"
 
 #define VRPN_USE_WINSOCK2
 
 #include "vrpn/vrpn_Tracker.h"
 #include "vrpn/vrpn_Connection.h"
+#include "vrpn/vrpn_Clock.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <vector>
 
 
 /*
  * VRPN (Virtual Reality Private Network) interface to exchange tracking data between programs (locally or on the network)
  */
 
+struct vrpn_Receiver;
+
+enum class TrackerStatus
+{
+	Idle, // Not connected, e.g. while editing
+	Searching, // Resolving or connecting to server, or waiting to retry
+	Connected, // Connected to server, but no poses received
+	Tracking, // Receiving poses
+	Lost // Was tracking, but poses or connection stopped
+};
+
+const char *TrackerStatusName(TrackerStatus status);
+
+/**
+ * Streaming state of a tracker, written by the single thread feeding it and read by any thread without locking
+ * Shared with snapshots of the tracker list, so readers may keep using it after the tracker has been removed
+ */
+struct TrackerStream
+{
+	struct Published
+	{
+		TimePoint_t lastPacket, lastTimestamp;
+		unsigned int packets = 0;
+	};
+	SeqLock<Published> published;
+	StreamStats stats;
+	PoseStore sensors;
+};
+
 struct vrpn_Tracker_Wrapper
 {
+	uint32_t id; // Unique for the lifetime of the program, e.g. to identify packet trace records
+	SlotHandle handle; // Handle in tracker registry
 	std::string path;
 	bool editing = false;
+	bool replay = false; // Fed by CaptureReplay instead of a connection
+	bool configured = false; // Listed in config file, so removed when it is removed from there
 	std::unique_ptr<vrpn_Tracker_Remote> remote = nullptr;
-	bool receivedPackets = false;
-	TimePoint_t lastPacket, lastTimestamp;
-	bool logPackets = true;
-	Eigen::Isometry3f pose;
+	vrpn_Receiver *receiver = nullptr;
+	std::atomic<TrackerStatus> status = TrackerStatus::Idle; // Managed by ConnectionManager
+	bool tracePackets = true; // Record packets in PacketTrace
+	float lookaheadMS = 0.0f; // Time past now to predict poses at for display, to hide transport and display latency
 
-	vrpn_Tracker_Wrapper(std::string Path);
+	std::shared_ptr<TrackerStream> stream = std::make_shared<TrackerStream>();
+	SeqLock<TrackerStream::Published> &published = stream->published;
+	StreamStats &stats = stream->stats;
+	PoseStore &sensors = stream->sensors;
+
+	vrpn_Tracker_Wrapper(std::string Path, float LookaheadMS = 0.0f);
 
 	bool isConnected();
 
-	void connect();
+	void connect(vrpn_Connection *connection);
+
+	/**
+	 * Publish a received pose to all consumers, from the single thread feeding this tracker
+	 */
+	void deliverPose(int sensor, const Eigen::Vector3f &pos, const Eigen::Quaternionf &rot,
+		TimePoint_t timestamp, TimePoint_t received);
+};
+
+struct vrpn_Worker;
+
+/**
+ * Owns a single vrpn_Connection and dispatches its packets to all attached trackers
+ * Serviced by the vrpn_Worker it is assigned to, so that slow connections only stall connections of the same worker
+ * Trackers may only be attached/detached through this, since their handlers are called from the receiving thread
+ */
+struct vrpn_Receiver
+{
+	opaque_ptr<vrpn_Connection> connection;
+	vrpn_Worker *worker = nullptr; // Only changed while both workers are locked
+	std::vector<vrpn_Tracker_Wrapper*> trackers; // Protected by worker
+	std::unique_ptr<vrpn_Clock_Remote> clock; // Protected by worker
+	// Offset from remote to local system clock as measured by clock sync, 0 if not synced
+	std::atomic<long long> remoteOffsetUS = 0, remoteRoundTripUS = -1;
+
+	vrpn_Receiver(opaque_ptr<vrpn_Connection> &&Connection, vrpn_Worker &Worker);
+	~vrpn_Receiver();
+
+	/**
+	 * Lock the worker of this receiver, making it yield once the current wait for packets ends
+	 */
+	std::unique_lock<std::mutex> acquire();
+
+	void attach(vrpn_Tracker_Wrapper &tracker);
+	void detach(vrpn_Tracker_Wrapper &tracker);
+
+	/**
+	 * Estimate the clock offset to the server using a VRPN clock device (e.g. Clock0@host), empty to disable
+	 */
+	void syncClock(const std::string &clockPath);
+
+	/**
+	 * Immutable snapshot of the senders (e.g. trackers) known to the connection, local or remote
+	 */
+	struct Discovery
+	{
+		uint32_t generation = 0;
+		std::vector<std::string> senders;
+	};
+
+	/**
+	 * Latest discovery snapshot, only refreshed by the receiving thread when the connection reports new senders
+	 */
+	std::shared_ptr<const Discovery> discovery() const;
+
+	/**
+	 * Generation of the latest discovery snapshot, to cheaply check for changes
+	 */
+	uint32_t discoveryGeneration() const { return discoveryGen.load(std::memory_order_acquire); }
+
+private:
+	friend vrpn_Worker;
+	TimePoint_t lastService = {};
+	int knownSenders = 0; // Protected by worker
+	mutable std::mutex discoveryMutex;
+	std::shared_ptr<const Discovery> discoverySnapshot;
+	std::atomic<uint32_t> discoveryGen = 0;
+
+	bool isActive() const { return !trackers.empty() && connection->connected(); }
+	unsigned int countPackets() const;
+	void service(long timeoutUS);
+	void discover();
 };
 
-std::vector<std::string> vrpn_getKnownTrackers(vrpn_Connection *connection);
+/**
+ * Receiving thread servicing any number of receivers in its own event loop under its own lock
+ * Blocks in the select of a connection until packets arrive if it only has one active connection,
+ * else polls all active connections and blocks in each in turn for a short slice if none had packets
+ * VRPN does not expose the sockets of a connection to wait on several at once
+ * Receivers without trackers or without a server are only serviced at a low rate (e.g. for reconnecting)
+ */
+struct vrpn_Worker
+{
+	const int index;
+	std::vector<vrpn_Receiver*> receivers; // Protected by mutex
+
+	// Load statistics, written by receiving thread, read by any thread
+	std::atomic<int> trackerCount = 0, activeCount = 0;
+	std::atomic<float> packetRate = 0;
+
+	vrpn_Worker(int Index);
+
+	/**
+	 * Lock the worker, making the receiving thread yield once the current wait for packets ends
+	 */
+	std::unique_lock<std::mutex> acquire();
+
+	/**
+	 * Move receiver to this worker
+	 */
+	void adopt(vrpn_Receiver &receiver);
+
+	/**
+	 * Wake up receiving thread after a change to its receivers (expects to be locked)
+	 */
+	void notify();
+
+private:
+	std::mutex mutex; // Held by receiving thread while waiting for and dispatching packets
+	std::condition_variable_any wakeup;
+	std::atomic<int> pending = 0;
+	bool dirty = false;
+	// Declared last so that it is joined before anything else is destroyed
+	std::jthread thread;
+
+	void run(std::stop_token stop_token);
+};
 
 #endif /* VRPN_H */
@@ -0,0 +1,306 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "log_file.hpp"
+#include "app.hpp"
+
+#include "util/gzip.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#elif defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+LogFileSink::~LogFileSink()
+{
+	close();
+}
+
+bool LogFileSink::open(const Options &options)
+{
+	close();
+	m_options = options;
+	if (!openFile())
+		return false;
+	m_wallOffset = std::chrono::system_clock::now().time_since_epoch()
+		- std::chrono::duration_cast<std::chrono::system_clock::duration>(sclock::now().time_since_epoch());
+	m_prefixSecond = 0;
+	m_next = 0;
+	m_written = 0;
+	m_skipped = 0;
+	m_bytes = 0;
+	m_thread = std::jthread([this](std::stop_token stop_token){ run(stop_token); });
+	LOG(LIO, LInfo, "Writing logs to '%s'!", m_options.path.c_str());
+	return true;
+}
+
+void LogFileSink::close()
+{
+	if (m_thread.joinable())
+	{ // Writes remaining logs before returning
+		m_thread.request_stop();
+		m_thread.join();
+	}
+	closeFile();
+}
+
+void LogFileSink::closeFile()
+{
+	if (m_fd < 0) return;
+#ifdef __unix__
+	::close(m_fd);
+#elif defined(_WIN32)
+	::_close(m_fd);
+#endif
+	m_fd = -1;
+}
+
+void LogFileSink::run(std::stop_token stop_token)
+{
+	std::mutex mutex;
+	std::condition_variable_any wakeup;
+	while (!stop_token.stop_requested() && m_fd >= 0)
+	{
+		writeLogs();
+		std::unique_lock lock(mutex);
+		wakeup.wait_for(lock, stop_token, std::chrono::milliseconds(m_options.intervalMS), [](){ return false; });
+	}
+	if (m_fd >= 0)
+		writeLogs();
+}
+
+void LogFileSink::writeLogs()
+{
+	auto logs = GetApp().logEntries.getView();
+	Line lines[BatchEntries];
+	char prefixes[BatchEntries][PrefixSize];
+	int count = 0;
+	auto flush = [&]()
+	{
+		bool success = writeLines(lines, count);
+		count = 0;
+		if (success && m_options.maxBytes > 0 && m_fileSize >= m_options.maxBytes)
+			rotate();
+		return success && m_fd >= 0;
+	};
+
+	std::string note;
+	if (m_next < logs.beginIndex())
+	{ // Culled from memory before they could be written, e.g. due to a stalled disk
+		std::size_t skipped = logs.beginIndex() - m_next;
+		m_skipped.fetch_add(skipped, std::memory_order_relaxed);
+		m_next = logs.beginIndex();
+		note = asprintf_s("Skipped %lu log entries dropped before they could be written!", (unsigned long)skipped);
+		lines[count].prefix = prefixes[count];
+		lines[count].prefixSize = formatPrefix(prefixes[count], sclock::now(), LIO, LWarn);
+		lines[count].text = note;
+		count++;
+	}
+
+	for (; m_next < logs.endIndex(); m_next++)
+	{
+		const AppState::LogEntry &entry = logs[m_next];
+		if (entry.level < m_options.minLevel)
+			continue;
+		lines[count].prefix = prefixes[count];
+		lines[count].prefixSize = formatPrefix(prefixes[count], entry.timestamp, entry.category, entry.level);
+		lines[count].text = entry.text(logs.arena(m_next));
+		count++;
+		if (count == BatchEntries && !flush())
+		{
+			m_next++;
+			return;
+		}
+	}
+	if (count > 0)
+		flush();
+}
+
+std::size_t LogFileSink::formatPrefix(char *prefix, TimePoint_t timestamp, LogCategory category, LogLevel level)
+{
+	auto wall = std::chrono::system_clock::time_point(
+		std::chrono::duration_cast<std::chrono::system_clock::duration>(timestamp.time_since_epoch()) + m_wallOffset);
+	std::time_t second = std::chrono::system_clock::to_time_t(wall);
+	if (second != m_prefixSecond)
+	{ // Only needs conversion to local time once per second
+		std::tm local;
+#ifdef _WIN32
+		localtime_s(&local, &second);
+#else
+		localtime_r(&second, &local);
+#endif
+		std::strftime(m_secondPrefix, sizeof(m_secondPrefix), "%Y-%m-%d %H:%M:%S", &local);
+		m_prefixSecond = second;
+	}
+	int ms = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(wall.time_since_epoch()).count() % 1000);
+	int size = std::snprintf(prefix, PrefixSize, "%s.%03d %s %s ", m_secondPrefix, ms,
+		LogCategoryIdentifiers[category], LogLevelIdentifiers[level]);
+	return std::min(size, PrefixSize-1);
+}
+
+bool LogFileSink::writeLines(const Line *lines, int count)
+{
+	if (count == 0 || m_fd < 0) return true;
+	std::size_t written = 0;
+#ifdef __unix__
+	// Vectored writes of whole batches straight from the log arenas, without copying
+	static const char newline = '\n';
+	iovec iov[BatchEntries*3];
+	int num = 0;
+	for (int i = 0; i < count; i++)
+	{
+		iov[num++] = { (void*)lines[i].prefix, lines[i].prefixSize };
+		if (!lines[i].text.empty())
+			iov[num++] = { (void*)lines[i].text.data(), lines[i].text.size() };
+		iov[num++] = { (void*)&newline, 1 };
+	}
+	iovec *vec = iov;
+	while (num > 0)
+	{
+		ssize_t result = ::writev(m_fd, vec, std::min(num, IOV_MAX));
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result < 0)
+			break;
+		written += result;
+		// Continue after partial writes
+		while (num > 0 && (std::size_t)result >= vec->iov_len)
+		{
+			result -= vec->iov_len;
+			vec++;
+			num--;
+		}
+		if (num > 0)
+		{
+			vec->iov_base = (char*)vec->iov_base + result;
+			vec->iov_len -= result;
+		}
+	}
+	bool success = num == 0;
+#elif defined(_WIN32)
+	// No vectored writes for files, so gather into one buffer instead
+	thread_local std::string buffer;
+	buffer.clear();
+	for (int i = 0; i < count; i++)
+	{
+		buffer.append(lines[i].prefix, lines[i].prefixSize);
+		buffer.append(lines[i].text);
+		buffer.push_back('\n');
+	}
+	while (written < buffer.size())
+	{
+		int result = ::_write(m_fd, buffer.data() + written, (unsigned int)(buffer.size() - written));
+		if (result <= 0) break;
+		written += result;
+	}
+	bool success = written == buffer.size();
+#else
+	bool success = false;
+#endif
+	m_fileSize += written;
+	m_bytes.fetch_add(written, std::memory_order_relaxed);
+	if (!success)
+	{
+		LOG(LIO, LError, "Failed to write logs to '%s': %s", m_options.path.c_str(), strerror(errno));
+		closeFile();
+		return false;
+	}
+	m_written.fetch_add(count, std::memory_order_relaxed);
+	return true;
+}
+
+bool LogFileSink::openFile()
+{
+#ifdef __unix__
+	m_fd = ::open(m_options.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#elif defined(_WIN32)
+	m_fd = ::_open(m_options.path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	LOG(LIO, LError, "Writing logs to files is not yet supported on this platform!");
+	return false;
+#endif
+	if (m_fd < 0)
+	{
+		LOG(LIO, LError, "Failed to open log file '%s': %s", m_options.path.c_str(), strerror(errno));
+		return false;
+	}
+	std::error_code error;
+	m_fileSize = std::filesystem::file_size(m_options.path, error);
+	if (error) m_fileSize = 0;
+	return true;
+}
+
+std::string LogFileSink::rotatedPath(int index) const
+{
+	return asprintf_s("%s.%d%s", m_options.path.c_str(), index, m_options.compress? ".gz" : "");
+}
+
+void LogFileSink::rotate()
+{
+	closeFile();
+	std::error_code error;
+	if (m_options.maxFiles > 0)
+	{ // Shift rotated files, dropping the oldest
+		std::filesystem::remove(rotatedPath(m_options.maxFiles), error);
+		for (int i = m_options.maxFiles-1; i >= 1; i--)
+			std::filesystem::rename(rotatedPath(i), rotatedPath(i+1), error);
+		if (m_options.compress)
+		{ // Compressed by this thread, logs meanwhile keep accumulating in memory
+			std::ifstream file(m_options.path, std::ios::binary);
+			std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			file.close();
+			std::vector<uint8_t> compressed = GzipCompress(data.data(), data.size());
+			std::ofstream gzip(rotatedPath(1), std::ios::binary | std::ios::trunc);
+			gzip.write((const char*)compressed.data(), compressed.size());
+			gzip.close();
+			if (!gzip.fail())
+				std::filesystem::remove(m_options.path, error);
+			else
+			{
+				LOG(LIO, LWarn, "Failed to compress log file to '%s'!", rotatedPath(1).c_str());
+				std::filesystem::remove(rotatedPath(1), error);
+			}
+		}
+		else
+			std::filesystem::rename(m_options.path, rotatedPath(1), error);
+	}
+	// If rotation failed, the file is replaced anyway, so that it does not grow indefinitely
+	std::filesystem::remove(m_options.path, error);
+	openFile();
+}
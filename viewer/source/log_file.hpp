@@ -0,0 +1,113 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef LOG_FILE_H
+#define LOG_FILE_H
+
+#include "util/log.hpp"
+#include "util/util.hpp" // TimePoint_t
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+
+/**
+ * Writes logs stored in AppState::logEntries to a file from a dedicated thread
+ * It reads the log queue like any other reader, so logging calls never wait on the disk,
+ * and writes all entries accumulated in an interval in large batched writes
+ * Each line is prefixed with local time, category and level
+ * Files are rotated by size to path.1, path.2, ..., optionally compressed to path.1.gz, ...
+ * Entries culled from memory before they could be written are skipped and noted in the file
+ */
+class LogFileSink
+{
+public:
+	static const int BatchEntries = 256;
+	static const int PrefixSize = 48;
+
+	struct Options
+	{
+		std::string path;
+		std::size_t maxBytes = 64*1024*1024; // Size of a file before it is rotated, 0 to disable
+		int maxFiles = 8; // Rotated files kept besides the current one
+		bool compress = false; // Gzip rotated files
+		LogLevel minLevel = LTrace;
+		int intervalMS = 200;
+	};
+
+	LogFileSink() {}
+	~LogFileSink();
+
+	/**
+	 * Open or append to file and start writing logs, including those already in memory
+	 */
+	bool open(const Options &options);
+	/**
+	 * Write all remaining logs and close file
+	 */
+	void close();
+	bool isOpen() const { return m_fd >= 0; }
+	const std::string &path() const { return m_options.path; }
+
+	uint64_t written() const { return m_written.load(std::memory_order_relaxed); }
+	uint64_t skipped() const { return m_skipped.load(std::memory_order_relaxed); }
+	uint64_t bytes() const { return m_bytes.load(std::memory_order_relaxed); }
+
+private:
+	struct Line
+	{
+		const char *prefix;
+		std::size_t prefixSize;
+		std::string_view text;
+	};
+
+	Options m_options;
+	int m_fd = -1;
+	std::size_t m_fileSize = 0;
+	std::size_t m_next = 0; // Index of next log entry to write
+	std::atomic<uint64_t> m_written = 0, m_skipped = 0, m_bytes = 0;
+
+	// Offset from sclock to system clock for wall time, and cached prefix of the current second
+	std::chrono::system_clock::duration m_wallOffset;
+	std::time_t m_prefixSecond = 0;
+	char m_secondPrefix[24];
+
+	std::jthread m_thread;
+
+	void run(std::stop_token stop_token);
+	void writeLogs();
+	bool writeLines(const Line *lines, int count);
+	std::size_t formatPrefix(char *prefix, TimePoint_t timestamp, LogCategory category, LogLevel level);
+	bool openFile();
+	void closeFile();
+	void rotate();
+	std::string rotatedPath(int index) const;
+};
+
+#endif // LOG_FILE_H
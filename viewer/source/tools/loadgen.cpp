@@ -0,0 +1,219 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/util.hpp" // TimePoint_t, dtUS
+
+#define VRPN_USE_WINSOCK2
+
+#include "vrpn/vrpn_Tracker.h"
+#include "vrpn/vrpn_Connection.h"
+#include "vrpn/quat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <csignal>
+#include <atomic>
+
+/**
+ * Synthetic VRPN load generator
+ * Publishes N trackers with M sensors each at a fixed rate, moving along deterministic trajectories
+ * Each pose carries its send time as message timestamp, so receivers can measure latency
+ */
+
+struct Options
+{
+	int trackers = 8;
+	int sensors = 1;
+	float rate = 240;
+	int port = vrpn_DEFAULT_LISTEN_PORT_NO;
+	float duration = 0;
+	std::string prefix = "LoadTarget_";
+};
+
+static std::atomic<bool> quit = false;
+
+static void printUsage(const char *program)
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --trackers N    Number of trackers to publish (default 8)\n");
+	printf("  --sensors M     Number of sensors per tracker (default 1)\n");
+	printf("  --rate HZ       Poses per second per sensor (default 240)\n");
+	printf("  --port PORT     Port to listen on (default %d)\n", vrpn_DEFAULT_LISTEN_PORT_NO);
+	printf("  --prefix NAME   Prefix of tracker names, followed by a 4-digit index (default LoadTarget_)\n");
+	printf("  --duration S    Seconds to run for, 0 to run until interrupted (default 0)\n");
+}
+
+static bool parseOptions(int argc, char **argv, Options &opts)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+			return false;
+		if (i+1 >= argc)
+		{
+			fprintf(stderr, "Missing value for option %s!\n", arg);
+			return false;
+		}
+		const char *value = argv[++i];
+		if (std::strcmp(arg, "--trackers") == 0)
+			opts.trackers = std::atoi(value);
+		else if (std::strcmp(arg, "--sensors") == 0)
+			opts.sensors = std::atoi(value);
+		else if (std::strcmp(arg, "--rate") == 0)
+			opts.rate = std::atof(value);
+		else if (std::strcmp(arg, "--port") == 0)
+			opts.port = std::atoi(value);
+		else if (std::strcmp(arg, "--prefix") == 0)
+			opts.prefix = value;
+		else if (std::strcmp(arg, "--duration") == 0)
+			opts.duration = std::atof(value);
+		else
+		{
+			fprintf(stderr, "Unknown option %s!\n", arg);
+			return false;
+		}
+	}
+	if (opts.trackers <= 0 || opts.sensors <= 0 || opts.rate <= 0)
+	{
+		fprintf(stderr, "Trackers, sensors and rate need to be positive!\n");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Deterministic trajectory, a lissajous curve with a slowly spinning rotation, distinct per tracker and sensor
+ */
+static void evaluateTrajectory(int tracker, int sensor, double time, vrpn_float64 pos[3], vrpn_float64 quat[4])
+{
+	double phase = tracker * 0.7 + sensor * 0.3;
+	double radius = 0.5 + 0.1 * (tracker % 5);
+	pos[0] = radius * std::sin(0.5 * time + phase);
+	pos[1] = radius * std::sin(0.7 * time + 2 * phase);
+	pos[2] = 1.0 + 0.2 * std::sin(0.3 * time + phase) + 0.05 * sensor;
+	double axis[3] = { std::sin(phase), std::cos(phase), 0.5 };
+	double norm = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+	double angle = 0.8 * time + phase;
+	double s = std::sin(angle/2) / norm;
+	quat[Q_X] = axis[0] * s;
+	quat[Q_Y] = axis[1] * s;
+	quat[Q_Z] = axis[2] * s;
+	quat[Q_W] = std::cos(angle/2);
+}
+
+int main(int argc, char **argv)
+{
+	Options opts;
+	if (!parseOptions(argc, argv, opts))
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	vrpn_Connection *connection = vrpn_create_server_connection(opts.port);
+	if (!connection || !connection->doing_okay())
+	{
+		fprintf(stderr, "Failed to create server connection on port %d!\n", opts.port);
+		return 2;
+	}
+
+	std::vector<std::unique_ptr<vrpn_Tracker_Server>> trackers;
+	for (int t = 0; t < opts.trackers; t++)
+	{
+		char name[256];
+		snprintf(name, sizeof(name), "%s%04d", opts.prefix.c_str(), t);
+		trackers.push_back(std::make_unique<vrpn_Tracker_Server>(name, connection, opts.sensors));
+	}
+	printf("Publishing %d trackers with %d sensors each at %.1fHz on port %d (%.0f poses/s)\n",
+		opts.trackers, opts.sensors, opts.rate, opts.port, opts.trackers * opts.sensors * opts.rate);
+
+	std::signal(SIGINT, [](int){ quit = true; });
+	std::signal(SIGTERM, [](int){ quit = true; });
+
+	const long intervalUS = 1000000 / opts.rate;
+	TimePoint_t start = sclock::now(), next = start, lastStats = start;
+	unsigned long ticks = 0, poses = 0, statTicks = 0, overruns = 0;
+	long maxLagUS = 0;
+	while (!quit)
+	{
+		TimePoint_t now = sclock::now();
+		if (opts.duration > 0 && dtUS(start, now) >= opts.duration*1000000)
+			break;
+
+		// Trajectories depend only on the tick, not on actual timing, so runs are reproducible
+		double time = ticks / (double)opts.rate;
+		for (int t = 0; t < opts.trackers; t++)
+		{
+			for (int s = 0; s < opts.sensors; s++)
+			{
+				vrpn_float64 pos[3], quat[4];
+				evaluateTrajectory(t, s, time, pos, quat);
+				struct timeval sendTime;
+				vrpn_gettimeofday(&sendTime, NULL);
+				trackers[t]->report_pose(s, sendTime, pos, quat);
+				poses++;
+			}
+			trackers[t]->mainloop();
+		}
+		connection->mainloop();
+		ticks++;
+		statTicks++;
+
+		next += std::chrono::microseconds(intervalUS);
+		long lagUS = dtUS(next, sclock::now());
+		if (lagUS > 0)
+		{ // Could not keep up with rate, don't try to catch up by bursting
+			overruns++;
+			maxLagUS = std::max(maxLagUS, lagUS);
+			next = sclock::now();
+		}
+		else
+			std::this_thread::sleep_until(next);
+
+		if (dtUS(lastStats, sclock::now()) >= 1000000)
+		{
+			float elapsedS = dtUS(lastStats, sclock::now()) / 1000000.0f;
+			printf("%.0f poses/s, %.1f ticks/s, %lu overruns (max lag %.2fms), %d connected\n",
+				poses / elapsedS, statTicks / elapsedS, overruns, maxLagUS / 1000.0f,
+				connection->connected()? 1 : 0);
+			poses = 0;
+			statTicks = 0;
+			overruns = 0;
+			maxLagUS = 0;
+			lastStats = sclock::now();
+		}
+	}
+
+	trackers.clear();
+	connection->removeReference();
+	return 0;
+}
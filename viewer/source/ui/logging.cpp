@@ -35,7 +35,7 @@ void InterfaceState::UpdateLogging(InterfaceWindow &window)
 	}
 
 	static std::size_t selectedLog = -1, focusedLog = -1;
-	GetApp().logEntries.delete_culled();
+	// Culled logs are deleted in the background by AppState::StartLogMaintenance
 	auto logs = GetApp().logEntries.getView();
 
 	if (ImGui::BeginChild("scrolling", ImGui::GetContentRegionAvail(), false, ImGuiWindowFlags_HorizontalScrollbar))
@@ -52,6 +52,23 @@ void InterfaceState::UpdateLogging(InterfaceWindow &window)
 			}
 			else
 			{ // Continue sorting new items from filterPos
+				// Drop filtered logs culled from the front in the background, keeping the visible logs in place
+				std::size_t culled = 0;
+				while (culled < logsFiltered.size() && logsFiltered[culled] < logs.beginIndex())
+					culled++;
+				if (culled > 0)
+				{
+					BlockedVector<std::size_t> kept;
+					for (std::size_t i = culled; i < logsFiltered.size(); i++)
+						kept.push_back(logsFiltered[i]);
+					logsFiltered.swap(kept);
+					if (!logsStickToNew)
+						ImGui::SetScrollY(std::max(0.0f, ImGui::GetScrollY() - culled*ImGui::GetTextLineHeight()));
+					if (selectedLog < logs.beginIndex())
+						selectedLog = -1;
+					if (focusedLog < logs.beginIndex())
+						focusedLog = -1;
+				}
 				pos = logs.pos(std::max(logs.beginIndex(), logsFilterPos));
 				assert(pos.valid());
 			}
@@ -141,7 +158,9 @@ void InterfaceState::UpdateLogging(InterfaceWindow &window)
 					ImGui::TextUnformatted(LogLevelIdentifiers[entry.level], LogLevelIdentifiers[entry.level]+5);
 
 					ImGui::SameLine(startLog);
-					ImGui::TextUnformatted(entry.log.c_str(), entry.log.c_str()+entry.log.size());
+					// Only visible entries are ever formatted by the UI
+					std::string_view text = entry.text(logs.arena(logsFiltered[i]));
+					ImGui::TextUnformatted(text.data(), text.data()+text.size());
 
 					ImGui::PopStyleColor();
 
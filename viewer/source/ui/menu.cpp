@@ -74,6 +74,7 @@ void InterfaceState::UpdateMainMenuBar()
 		addWindowMenuItem(windows[WIN_PROTOCOL]);
 		ImGui::Separator();
 		addWindowMenuItem(windows[WIN_LOGGING]);
+		addWindowMenuItem(windows[WIN_PACKET_TRACE]);
 		ImGui::Separator();
 		if (ImGui::BeginMenu("Dear ImGUI"))
 		{
@@ -38,13 +38,15 @@ void InterfaceState::UpdateProtocols(InterfaceWindow &window)
 	{ // VRPN UI
 
 		auto io_lock = std::unique_lock(state.io.mutex);
+		// Connection state is read without locking the receiver, which is fine for display purposes
+		vrpn_Connection *local = state.io.vrpn_local->connection.get();
 
 		BeginSection("Local VRPN server");
-		if (!state.io.vrpn_local->connected())
+		if (!local->connected())
 		{
 			ImGui::TextUnformatted("Not connected to a local server.");
 		}
-		else if (!state.io.vrpn_local->doing_okay())
+		else if (!local->doing_okay())
 		{
 			ImGui::TextUnformatted("Connection to local server broken!");
 		}
@@ -57,68 +59,99 @@ void InterfaceState::UpdateProtocols(InterfaceWindow &window)
 		BeginSection("Known Trackers (?)");
 		ImGui::SetItemTooltip("Any trackers remote is exposing or local is attempting to connect.");
 
-		auto localTrackers = vrpn_getKnownTrackers(state.io.vrpn_local.get());
-		for (auto trackerPath : localTrackers)
+		// Discovery is refreshed by the receiving thread, only take a new snapshot when it changed
+		if (!knownTrackers || knownTrackers->generation != state.io.vrpn_local->discoveryGeneration())
+			knownTrackers = state.io.vrpn_local->discovery();
+		ImGuiListClipper clipper;
+		clipper.Begin(knownTrackers->senders.size(), ImGui::GetFrameHeightWithSpacing());
+		while (clipper.Step())
 		{
-			ImGui::Text("  - %s", trackerPath.c_str());
-			SameLineTrailing(ImGui::GetFrameHeight());
-			if (ImGui::Button(asprintf_s("+##%s", trackerPath.c_str()).c_str(), ImVec2(ImGui::GetFrameHeight(), 0)))
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 			{
-				bool found = false;
-				for (auto &trk : state.io.vrpn_trackers)
-				{
-					if (trk.path.size() < trackerPath.size()) continue;
-					if (trk.path.compare(0, trackerPath.size(), trackerPath) != 0) continue;
-					if (trk.path.size() > trackerPath.size() && trk.path[trackerPath.size()] != '@') continue;
-					found = true;
-					break;
-				}
-				if (!found)
+				const std::string &trackerPath = knownTrackers->senders[i];
+				ImGui::PushID(i);
+				ImGui::AlignTextToFramePadding();
+				ImGui::Text("  - %s", trackerPath.c_str());
+				SameLineTrailing(ImGui::GetFrameHeight());
+				if (ImGui::Button("+", ImVec2(ImGui::GetFrameHeight(), 0)))
 				{
-					state.io.vrpn_trackers.emplace_back(trackerPath);
-					state.io.vrpn_trackers.back().connect();
+					bool found = false;
+					for (auto &trk : state.io.vrpn_trackers)
+					{
+						if (trk.path.size() < trackerPath.size()) continue;
+						if (trk.path.compare(0, trackerPath.size(), trackerPath) != 0) continue;
+						if (trk.path.size() > trackerPath.size() && trk.path[trackerPath.size()] != '@') continue;
+						found = true;
+						break;
+					}
+					if (!found)
+						ConnectTracker(state, AddTracker(state, trackerPath));
 				}
+				ImGui::PopID();
 			}
 		}
 
 		EndSection();
 
 		BeginSection("Connected Trackers");
-		int index = 0;
+		for (auto &event : state.io.connections->events())
+			trackerStatusChanged[event.tracker] = event.time;
 		for (auto trk = state.io.vrpn_trackers.begin(); trk != state.io.vrpn_trackers.end();)
 		{
-			ImGui::PushID(index);
+			ImGui::PushID(trk->handle.index);
 			ImGui::PushID(trk->path.c_str());
-			if (ImGui::Selectable("", selectedTarget == index, ImGuiSelectableFlags_SpanAvailWidth | ImGuiSelectableFlags_AllowOverlap,  ImVec2(0, ImGui::GetFrameHeight())))
-				selectedTarget = index;
+			if (ImGui::Selectable("", selectedTracker == trk->handle, ImGuiSelectableFlags_SpanAvailWidth | ImGuiSelectableFlags_AllowOverlap,  ImVec2(0, ImGui::GetFrameHeight())))
+				selectedTracker = trk->handle;
 			ImGui::SameLine();
 			ImGui::AlignTextToFramePadding();
 			if (trk->editing)
 			{
-				trk->remote = nullptr;
+				DisconnectTracker(state, *trk);
 				ImGui::SetNextItemWidth(LineWidthRemaining() - ImGui::GetFrameHeight()*2 - ImGui::GetStyle().ItemSpacing.x*2);
 				ImGui::InputText("##path", &trk->path);
 			}
 			else
 				ImGui::Text("%s", trk->path.c_str());
 
-			if (trk->remote && !trk->editing)
+			if (!trk->editing && !trk->replay)
+			{ // Status is managed by the connection manager, in the background
+				TrackerStatus status = trk->status.load(std::memory_order_relaxed);
+				const char *statusName = TrackerStatusName(status);
+				SameLineTrailing(ImGui::CalcTextSize(statusName).x + ImGui::GetFrameHeight()*2 + ImGui::GetStyle().ItemSpacing.x*2);
+				ImGui::AlignTextToFramePadding();
+				ImGui::TextUnformatted(statusName);
+				auto published = trk->published.read();
+				if (ImGui::BeginItemTooltip())
+				{
+					auto changed = trackerStatusChanged.find(trk->handle);
+					if (changed != trackerStatusChanged.end())
+						ImGui::Text("%s for %.1fs", statusName, dt(changed->second, sclock::now())/1000.0f);
+					if (published.packets > 0)
+						ImGui::Text("Latency: %.2fms", dtUS(published.lastTimestamp, published.lastPacket)/1000.0f);
+					auto stats = trk->stats.read();
+					if (stats.updated != TimePoint_t())
+					{ // Snapshot of last completed window
+						ImGui::Text("Rate: %.1f frames/s (%.1f packets/s)%s", stats.frameRate, stats.packetRate, stats.stalled? " (stalled)" : "");
+						ImGui::Text("Interval: %.2fms, jitter %.3fms", stats.intervalMS, stats.jitterMS);
+						ImGui::Text("Latency percentiles: p50 %.2fms, p90 %.2fms, p99 %.2fms, max %.2fms",
+							stats.latencyP50MS, stats.latencyP90MS, stats.latencyP99MS, stats.latencyMaxMS);
+						if (stats.negativeLatency > 0)
+							ImGui::Text("%u packets with negative latency, sync clocks for accurate latency", stats.negativeLatency);
+						ImGui::Text("%u gaps, %u dropouts over %lu frames", stats.gaps, stats.dropouts, (unsigned long)stats.frames);
+					}
+					long long roundTripUS = trk->receiver? trk->receiver->remoteRoundTripUS.load() : -1;
+					if (roundTripUS >= 0)
+						ImGui::Text("Clock offset to server: %.2fms (round-trip %.2fms)",
+							trk->receiver->remoteOffsetUS/1000.0f, roundTripUS/1000.0f);
+					else
+						ImGui::TextUnformatted("Clock offset to server: Not synced");
+					ImGui::EndTooltip();
+				}
+				ImGui::SameLine();
+			}
+			else if (trk->replay)
 			{
-				const char *status;
-				auto con = trk->remote->connectionPtr();
-				bool delayed = trk->receivedPackets && dt(trk->lastPacket, sclock::now()) > 50;
-				if (trk->receivedPackets && !delayed && con->connected())
-					status = "Tracking";
-				else if (trk->receivedPackets && !trk->isConnected())
-					status = "Connection Lost";
-				else if (trk->receivedPackets && !con->doing_okay())
-					status = "Connection Broken"; // TODO: This might be redundant, isConnected should cover it all
-				else if (trk->receivedPackets && delayed)
-					status = "Tracking Lost";
-				else if (trk->isConnected())
-					status = "Connected";
-				else
-					status = "Searching";
+				const char *status = "Replay";
 				SameLineTrailing(ImGui::CalcTextSize(status).x + ImGui::GetFrameHeight()*2 + ImGui::GetStyle().ItemSpacing.x*2);
 				ImGui::AlignTextToFramePadding();
 				ImGui::TextUnformatted(status);
@@ -128,25 +161,43 @@ void InterfaceState::UpdateProtocols(InterfaceWindow &window)
 			{
 				SameLineTrailing(ImGui::GetFrameHeight()*2 + ImGui::GetStyle().ItemSpacing.x);
 			}
+			// Replayed trackers are managed by the replay
+			ImGui::BeginDisabled(trk->replay);
 			if (ImGui::Button("E", ImVec2(ImGui::GetFrameHeight(), 0)))
 			{
 				trk->editing = !trk->editing;
 				if (!trk->editing && !trk->remote)
-					trk->connect();
+					ConnectTracker(state, *trk);
 			}
 			ImGui::SameLine();
 			bool remove = CrossButton("Del");
+			ImGui::EndDisabled();
+			if (selectedTracker == trk->handle && trk->sensors.sensors() > 0)
+			{ // List all sensors of the selected tracker
+				ImGui::Indent();
+				ImGui::SetNextItemWidth(SizeWidthDiv3_2().x);
+				if (ImGui::SliderFloat("Lookahead", &trk->lookaheadMS, 0.0f, 100.0f, "%.0fms"))
+					PublishTrackers(state);
+				ImGui::SetItemTooltip("Time past now to predict poses at when pose prediction is enabled in the 3D view.");
+				trk->sensors.forEach([&](const PoseStore::Sample &sample)
+				{
+					PoseStore::Motion motion;
+					trk->sensors.motion(sample.sensor, motion);
+					ImGui::Text("Sensor %d: %u updates at (%.3f, %.3f, %.3f), %.2fm/s (%s)", sample.sensor, sample.updates,
+						sample.position.x(), sample.position.y(), sample.position.z(),
+						motion.velocity.norm(), motion.reported? "reported" : "estimated");
+				});
+				ImGui::Unindent();
+			}
 			ImGui::PopID();
 			ImGui::PopID();
 			if (remove)
 			{
-				trk = state.io.vrpn_trackers.erase(trk);
-				if (selectedTarget == index) selectedTarget = -1;
-				else if (selectedTarget > index) selectedTarget--;
+				trackerStatusChanged.erase(trk->handle);
+				trk = RemoveTracker(state, trk);
 				continue;
 			}
 			trk++;
-			index++;
 		}
 
 		{
@@ -156,13 +207,126 @@ void InterfaceState::UpdateProtocols(InterfaceWindow &window)
 			ImGui::SameLine();
 			if (ImGui::Button("Connect", SizeWidthDiv3()))
 			{
-				state.io.vrpn_trackers.emplace_back(std::move(path));
-				state.io.vrpn_trackers.back().connect();
+				ConnectTracker(state, AddTracker(state, std::move(path)));
 				path.clear();
 			}
 		}
 
 		EndSection();
+
+		BeginSection("Capture (?)");
+		ImGui::SetItemTooltip("Record all received poses into a capture file, readable while being written.");
+		{
+			static std::string capturePath = "recording.astrcap";
+			if (state.io.capture)
+			{
+				auto &capture = *state.io.capture;
+				ImGui::Text("Recording into %s", capture.path().c_str());
+				ImGui::Text("%lu samples (%lu dropped), %.1fMB", (unsigned long)capture.records(),
+					(unsigned long)capture.dropped(), capture.fileSize()/1000000.0f);
+				if (ImGui::Button("Stop Recording", SizeWidthFull()))
+					StopCapture(state);
+			}
+			else
+			{
+				ImGui::SetNextItemWidth(SizeWidthDiv3_2().x);
+				ImGui::InputText("##CapturePath", &capturePath);
+				ImGui::SameLine();
+				if (ImGui::Button("Record", SizeWidthDiv3()))
+					StartCapture(state, capturePath);
+			}
+		}
+		EndSection();
+
+		BeginSection("Replay (?)");
+		ImGui::SetItemTooltip("Replay a capture file, feeding its trackers just like received packets would.");
+		{
+			static std::string replayPath = "capture.astrcap";
+			if (state.io.replay)
+			{
+				auto &replay = *state.io.replay;
+				auto controls = replay.controls();
+				bool changed = false;
+				ImGui::Text("Replaying %s", replay.path().c_str());
+				ImGui::SameLine();
+				if (replay.ended()) ImGui::TextUnformatted("(Ended)");
+				else if (controls.paused) ImGui::TextUnformatted("(Paused)");
+
+				float positionS = replay.positionUS()/1000000.0f, durationS = replay.durationUS()/1000000.0f;
+				ImGui::SetNextItemWidth(LineWidthRemaining());
+				if (ImGui::SliderFloat("##Seek", &positionS, 0.0f, durationS, "%.2fs"))
+					replay.seek(positionS*1000000);
+
+				if (ImGui::Button(controls.paused? "Play" : "Pause", SizeWidthDiv3()))
+				{
+					controls.paused = !controls.paused;
+					changed = true;
+				}
+				ImGui::SameLine();
+				bool unlimited = controls.speed <= 0;
+				if (ImGui::Checkbox("Max Speed", &unlimited))
+				{
+					controls.speed = unlimited? 0.0f : 1.0f;
+					changed = true;
+				}
+				ImGui::SameLine();
+				changed |= ImGui::Checkbox("Loop", &controls.loop);
+				if (!unlimited)
+				{
+					ImGui::SetNextItemWidth(SizeWidthDiv3_2().x);
+					changed |= ImGui::SliderFloat("Speed", &controls.speed, 0.1f, 10.0f, "%.2fx", ImGuiSliderFlags_Logarithmic);
+				}
+				if (changed)
+					replay.setControls(controls);
+
+				ImGui::Text("%lu samples replayed", (unsigned long)replay.samples());
+				if (ImGui::Button("Stop Replay", SizeWidthFull()))
+				{
+					StopReplay(state);
+				}
+			}
+			else
+			{
+				ImGui::SetNextItemWidth(SizeWidthDiv3_2().x);
+				ImGui::InputText("##ReplayPath", &replayPath);
+				ImGui::SameLine();
+				if (ImGui::Button("Replay", SizeWidthDiv3()))
+					StartReplay(state, replayPath);
+			}
+		}
+		EndSection();
+
+		BeginSection("Shared Memory (?)");
+		ImGui::SetItemTooltip("Republish all received poses into shared memory, for local processes to read without copies (see shared/pose_shm.h).");
+		{
+			static std::string shmName = AT_SHM_DEFAULT_NAME;
+			if (state.io.publisher)
+			{
+				auto &publisher = *state.io.publisher;
+				ImGui::Text("Publishing into %s", publisher.name().c_str());
+				ImGui::Text("%lu poses published", (unsigned long)publisher.events());
+				if (ImGui::Button("Stop Publishing", SizeWidthFull()))
+					StopSharedMemory(state);
+			}
+			else
+			{
+				ImGui::SetNextItemWidth(SizeWidthDiv3_2().x);
+				ImGui::InputText("##ShmName", &shmName);
+				ImGui::SameLine();
+				if (ImGui::Button("Publish", SizeWidthDiv3()))
+					StartSharedMemory(state, shmName);
+			}
+		}
+		EndSection();
+
+		BeginSection("Receive Threads (?)");
+		ImGui::SetItemTooltip("Connections are distributed across threads, so slow connections only delay those on the same thread.");
+		for (auto &worker : state.io.vrpn_workers)
+		{
+			ImGui::Text("Thread %d: %d connections (%d active), %d trackers, %.0f packets/s", worker.index,
+				(int)worker.receivers.size(), worker.activeCount.load(), worker.trackerCount.load(), worker.packetRate.load());
+		}
+		EndSection();
 	}
 
 	// TODO: Add other protocols UIs here
@@ -0,0 +1,182 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ui.hpp"
+
+#include "io/vrpn.hpp"
+
+// Records kept for display, older records are discarded
+static const std::size_t traceMaxRecords = 1<<17;
+
+void InterfaceState::UpdatePacketTrace(InterfaceWindow &window)
+{
+	if (!ImGui::Begin(window.title.c_str(), &window.open))
+	{
+		ImGui::End();
+		return;
+	}
+	ClientState &state = GetState();
+
+	bool filterDirty = false;
+	if (!trace.paused)
+	{ // Collect new records from all receiving threads
+		std::size_t prevSize = trace.records.size();
+		GetPacketTrace().collect(trace.cursors, trace.records);
+		if (trace.records.size() > traceMaxRecords)
+		{ // Discard in bulk to not move records every frame
+			trace.records.erase(trace.records.begin(), trace.records.begin() + (trace.records.size() - traceMaxRecords/2));
+			filterDirty = true;
+		}
+		else if (trace.records.size() > prevSize)
+		{ // Continue filtering new records
+			for (std::size_t i = prevSize; i < trace.records.size(); i++)
+				if (trace.filter.matches(trace.records[i]))
+					trace.filtered.push_back(i);
+		}
+		if (trace.records.size() > prevSize && trace.stickToNew)
+			requireUpdates = std::max(requireUpdates, 1);
+	}
+
+	// Records only store tracker ids, which stay unique after trackers are removed
+	std::vector<std::pair<uint32_t, std::string>> trackerPaths;
+	auto trackerLabel = [&](int id) -> std::string
+	{
+		if (id < 0) return "All Trackers";
+		for (auto &trk : trackerPaths)
+			if (trk.first == (uint32_t)id) return trk.second;
+		return asprintf_s("Tracker #%d", id);
+	};
+
+	{ // Filter controls
+		auto trackers = GetTrackers(state);
+		for (auto &trk : trackers->trackers)
+			trackerPaths.emplace_back(trk.id, trk.path);
+		ImGui::SetNextItemWidth(SizeWidthDiv3().x);
+		if (ImGui::BeginCombo("##Tracker", trackerLabel(trace.filter.tracker).c_str()))
+		{
+			if (ImGui::Selectable("All Trackers", trace.filter.tracker < 0))
+			{
+				trace.filter.tracker = -1;
+				filterDirty = true;
+			}
+			for (auto &trk : trackers->trackers)
+			{
+				if (ImGui::Selectable(asprintf_s("%s##%d", trk.path.c_str(), trk.id).c_str(), trace.filter.tracker == (int)trk.id))
+				{
+					trace.filter.tracker = trk.id;
+					filterDirty = true;
+				}
+			}
+			ImGui::EndCombo();
+		}
+	}
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetFontSize()*6);
+	filterDirty |= ImGui::InputInt("Sensor", &trace.filter.sensor);
+	trace.filter.sensor = std::max(trace.filter.sensor, -1);
+	ImGui::SetItemTooltip("Sensor to show, -1 for all.");
+	ImGui::SameLine();
+	filterDirty |= ImGui::Checkbox("Pose", &trace.filter.pose);
+	ImGui::SameLine();
+	filterDirty |= ImGui::Checkbox("Vel", &trace.filter.velocity);
+	ImGui::SameLine();
+	filterDirty |= ImGui::Checkbox("Acc", &trace.filter.accel);
+	ImGui::SameLine();
+	ImGui::Checkbox("Pause", &trace.paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Clear"))
+	{
+		trace.records.clear();
+		filterDirty = true;
+	}
+	if (trace.cursors.dropped > 0)
+	{
+		ImGui::SameLine();
+		ImGui::Text("%lu dropped", (unsigned long)trace.cursors.dropped);
+		ImGui::SetItemTooltip("Records overwritten before they could be collected, e.g. while paused.");
+	}
+
+	if (filterDirty)
+	{
+		trace.filtered.clear();
+		for (std::size_t i = 0; i < trace.records.size(); i++)
+			if (trace.filter.matches(trace.records[i]))
+				trace.filtered.push_back(i);
+	}
+
+	ImGuiTableFlags flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter
+		| ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingFixedFit;
+	if (ImGui::BeginTable("Trace", 7, flags, ImGui::GetContentRegionAvail()))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Received");
+		ImGui::TableSetupColumn("Tracker");
+		ImGui::TableSetupColumn("Sensor");
+		ImGui::TableSetupColumn("Type");
+		ImGui::TableSetupColumn("Latency");
+		ImGui::TableSetupColumn("Vector");
+		ImGui::TableSetupColumn("Quaternion", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableHeadersRow();
+
+		static const char *typeLabels[] = { "Pose", "Vel", "Acc" };
+		TimePoint_t now = sclock::now();
+		// Only format visible records
+		ImGuiListClipper clipper;
+		clipper.Begin(trace.filtered.size());
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const PacketRecord &record = trace.records[trace.filtered[i]];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("-%.3fs", dtUS(record.received, now)/1000000.0f);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(trackerLabel(record.tracker).c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%d", record.sensor);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(typeLabels[record.type]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2fms", dtUS(record.timestamp, record.received)/1000.0f);
+				ImGui::TableNextColumn();
+				ImGui::Text("(%.4f, %.4f, %.4f)", record.vec[0], record.vec[1], record.vec[2]);
+				ImGui::TableNextColumn();
+				ImGui::Text("(%.4f, %.4f, %.4f, %.4f)", record.quat[0], record.quat[1], record.quat[2], record.quat[3]);
+			}
+		}
+		clipper.End();
+
+		if (ImGui::GetIO().MouseWheel > 0.0f && ImGui::GetScrollY() < ImGui::GetScrollMaxY())
+			trace.stickToNew = false;
+		else if (ImGui::GetIO().MouseWheel < 0.0f && ImGui::GetScrollY() == ImGui::GetScrollMaxY())
+			trace.stickToNew = true;
+		else if (trace.stickToNew)
+			ImGui::SetScrollY(ImGui::GetScrollMaxY());
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
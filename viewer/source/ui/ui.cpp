@@ -247,6 +247,7 @@ void InterfaceState::ResetWindowLayout()
 	// Associate all static windows with a panel by default
 	ImGui::DockBuilderDockWindow(windows[WIN_3D_VIEW].title.c_str(), mainPanelID);
 	ImGui::DockBuilderDockWindow(windows[WIN_LOGGING].title.c_str(), bottomPanelID);
+	ImGui::DockBuilderDockWindow(windows[WIN_PACKET_TRACE].title.c_str(), bottomPanelID);
 	ImGui::DockBuilderDockWindow(windows[WIN_PROTOCOL].title.c_str(), auxPanelID);
 	ImGui::DockBuilderDockWindow(windows[WIN_STYLE_EDITOR].title.c_str(), sidePanelID);
 	ImGui::DockBuilderDockWindow(windows[WIN_IMGUI_DEMO].title.c_str(), mainPanelID);
@@ -315,6 +316,7 @@ bool InterfaceState::Init()
 	// Initialise all static UI windows
 	windows[WIN_3D_VIEW] = InterfaceWindow("3D View", &InterfaceState::Update3DViewUI, true);
 	windows[WIN_LOGGING] = InterfaceWindow("Logging", &InterfaceState::UpdateLogging, true);
+	windows[WIN_PACKET_TRACE] = InterfaceWindow("Packet Trace", &InterfaceState::UpdatePacketTrace);
 	windows[WIN_PROTOCOL] = InterfaceWindow("Protocols", &InterfaceState::UpdateProtocols, true);
 
 	// Shortcut to ImGui's built-in style editor
@@ -42,6 +42,8 @@ SOFTWARE.
 
 #include "gl/visualisation.hpp"
 
+#include "io/packet_trace.hpp"
+
 #include "util/eigenutil.hpp"
 #include "util/util.hpp" // TimePoint_t
 #include "util/blocked_vector.hpp"
@@ -71,6 +73,7 @@ enum InterfaceWindows
 {
 	WIN_3D_VIEW,
 	WIN_LOGGING,
+	WIN_PACKET_TRACE,
 	WIN_PROTOCOL,
 	WIN_STYLE_EDITOR,
 	WIN_IMGUI_DEMO,
@@ -89,6 +92,12 @@ struct View3D
 	float distance;
 	Eigen::Vector3f target;
 
+	// Tracker visualisation
+	bool interpolate = true;
+	float maxExtrapolationMS = 20.0f;
+	bool predict = false; // Predict poses at now + lookahead of each tracker instead
+	float maxPredictionMS = 100.0f;
+
 	// Interaction
 	bool isDragging = false;
 	bool sidePanelOpen = true;
@@ -134,13 +143,39 @@ public:
 
 	// 3D View state
 	View3D view3D = {};
-	int selectedTarget = -1;
+	SlotHandle selectedTracker;
+	std::unordered_map<SlotHandle, TimePoint_t> trackerStatusChanged; // From ConnectionManager events
+	std::shared_ptr<const vrpn_Receiver::Discovery> knownTrackers; // Discovery snapshot of local connection
 
 	// Log state
 	BlockedVector<std::size_t> logsFiltered;
 	std::size_t logsFilterPos = 0;
 	bool logsStickToNew = true;
 
+	// Packet trace state
+	struct
+	{
+		PacketTrace::Cursors cursors;
+		std::vector<PacketRecord> records;
+		std::vector<std::size_t> filtered;
+		bool paused = false;
+		bool stickToNew = true;
+		struct
+		{
+			int tracker = -1, sensor = -1;
+			bool pose = true, velocity = true, accel = true;
+
+			inline bool matches(const PacketRecord &record) const
+			{
+				if (tracker >= 0 && record.tracker != (uint32_t)tracker) return false;
+				if (sensor >= 0 && record.sensor != sensor) return false;
+				if (record.type == PacketRecord::Pose) return pose;
+				if (record.type == PacketRecord::Velocity) return velocity;
+				return accel;
+			}
+		} filter;
+	} trace;
+
 	InterfaceState() { InterfaceInstance = this; }
 	~InterfaceState() { if (InterfaceInstance == this) InterfaceInstance = NULL; }
 
@@ -158,6 +193,7 @@ public:
 	void Update3DViewUI(InterfaceWindow &window);
 	void UpdateProtocols(InterfaceWindow &window);
 	void UpdateLogging(InterfaceWindow &window);
+	void UpdatePacketTrace(InterfaceWindow &window);
 
 	void UpdateStyleUI(InterfaceWindow &window);
 	void UpdateImGuiDemoUI(InterfaceWindow &window);
@@ -188,8 +188,11 @@ void InterfaceState::Update3DViewUI(InterfaceWindow &window)
 
 		if (view3D.orbit)
 		{
-			if (selectedTarget >= 0 && selectedTarget < state.io.vrpn_trackers.size())
-				view3D.target = std::next(state.io.vrpn_trackers.begin(), selectedTarget)->pose.translation();
+			PoseStore::Sample sample;
+			auto trackers = GetTrackers(state);
+			auto *tracker = trackers->find(selectedTracker);
+			if (tracker && tracker->stream->sensors.read(0, sample))
+				view3D.target = sample.position;
 			if (!view3D.target.hasNaN())
 				view3D.viewTransform.translation() = view3D.target + view3D.viewTransform.linear() * Eigen::Vector3f(0, 0, -view3D.distance); 
 		}
@@ -285,6 +288,22 @@ void InterfaceState::Update3DViewUI(InterfaceWindow &window)
 	{ // Side Panel
 		sidePanelWidth = ImGui::GetWindowWidth();
 
+		ImGui::Checkbox("Interpolate Poses", &view3D.interpolate);
+		ImGui::SetItemTooltip("Sample poses at render time from their history instead of showing the latest received pose.");
+		ImGui::BeginDisabled(!view3D.interpolate);
+		ImGui::SetNextItemWidth(100);
+		ImGui::SliderFloat("Extrapolation", &view3D.maxExtrapolationMS, 0.0f, 100.0f, "%.0fms");
+		ImGui::SetItemTooltip("Maximum time to extrapolate past the latest received pose.");
+		ImGui::EndDisabled();
+
+		ImGui::Checkbox("Predict Poses", &view3D.predict);
+		ImGui::SetItemTooltip("Predict poses at the current time plus the lookahead of each tracker from their velocity, to hide transport and display latency.");
+		ImGui::BeginDisabled(!view3D.predict);
+		ImGui::SetNextItemWidth(100);
+		ImGui::SliderFloat("Max Prediction", &view3D.maxPredictionMS, 0.0f, 200.0f, "%.0fms");
+		ImGui::SetItemTooltip("Maximum time to predict past the latest received pose, including transport latency.");
+		ImGui::EndDisabled();
+
 		ImGui::EndChild();
 	}
 
@@ -296,10 +315,24 @@ static void visualiseState3D(View3D &view3D, Eigen::Vector2i viewSize, float dT)
 	float visAspect = (float)viewSize.y()/viewSize.x();
 	ClientState &state = GetState();
 
+	// Never lock io.mutex while rendering, it may be held while waiting for receiving threads
+	auto trackers = GetTrackers(state);
+	TimePoint_t now = sclock::now();
+	long maxExtrapolationUS = view3D.maxExtrapolationMS*1000;
+	long maxPredictionUS = view3D.maxPredictionMS*1000;
+
 	if (view3D.orbit)
 	{
-		if (GetUI().selectedTarget >= 0 && GetUI().selectedTarget < state.io.vrpn_trackers.size())
-			view3D.target = std::next(state.io.vrpn_trackers.begin(), GetUI().selectedTarget)->pose.translation();
+		PoseStore::Sample sample;
+		if (auto *tracker = trackers->find(GetUI().selectedTracker))
+		{
+			bool valid;
+			if (view3D.predict)
+				valid = tracker->stream->sensors.predict(0, now + std::chrono::microseconds((long)(tracker->lookaheadMS*1000)), maxPredictionUS, sample);
+			else
+				valid = tracker->stream->sensors.sample(0, now, view3D.interpolate? maxExtrapolationUS : 0, sample);
+			if (valid) view3D.target = sample.position;
+		}
 		if (!view3D.target.hasNaN())
 			view3D.viewTransform.translation() = view3D.target + view3D.viewTransform.linear() * Eigen::Vector3f(0, 0, -view3D.distance); 
 	}
@@ -311,8 +344,27 @@ static void visualiseState3D(View3D &view3D, Eigen::Vector2i viewSize, float dT)
 	visualiseSkybox(time);
 	visualiseFloor();
 
-	for (auto &tracker : state.io.vrpn_trackers)
+	bool streaming = false;
+	for (auto &tracker : trackers->trackers)
 	{
-		visualisePose(tracker.pose, { 0.8f, 0.2f, 0.2f, 0.8f }, 0.5f, 3.0f);
+		auto visualiseSample = [](const PoseStore::Sample &sample)
+		{
+			visualisePose(sample.pose(), { 0.8f, 0.2f, 0.2f, 0.8f }, 0.5f, 3.0f);
+		};
+		PoseStore &sensors = tracker.stream->sensors;
+		if (view3D.predict)
+			sensors.forEachPredicted(now + std::chrono::microseconds((long)(tracker.lookaheadMS*1000)), maxPredictionUS, visualiseSample);
+		else if (view3D.interpolate)
+			sensors.forEach(now, maxExtrapolationUS, visualiseSample);
+		else
+			sensors.forEach(visualiseSample);
+		auto published = tracker.stream->published.read();
+		if (published.packets > 0 && dtUS(published.lastPacket, now) < 100000)
+			streaming = true;
+	}
+
+	if (streaming)
+	{ // Keep rendering at display rate while poses are streaming in
+		GetUI().RequestRender();
 	}
 }
\ No newline at end of file
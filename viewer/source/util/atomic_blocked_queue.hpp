@@ -0,0 +1,396 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ATOMIC_BLOCKED_QUEUE_H
+#define ATOMIC_BLOCKED_QUEUE_H
+
+#include "util/byte_arena.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib> // std::abs
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Lock-free multi-producer variant of BlockedQueue for append-only logs written from many threads
+ * push_back never locks or allocates (except as a fallback, see below), so it is safe to call from time-critical threads:
+ * - An entry index is reserved with a single atomic operation, the entry is written in place and then marked ready
+ * - Blocks of N entries are allocated ahead of time by a background allocator thread, woken once per block
+ * - Should the allocator ever fall behind, the producer allocates the block itself instead of waiting
+ * - Blocks are kept in a fixed ring of MaxBlocks, entries exceeding that capacity are dropped until blocks are culled
+ * Each block has a ByteArena of ArenaSize beside its entries for variable-sized data, freed together with the block
+ * Readers use Views like with BlockedQueue, which only ever expose the contiguous range of ready entries,
+ * so a slow producer holds back later entries from readers instead of readers seeing incomplete entries
+ * Views, culling and deletion of culled blocks use a mutex, which producers never touch
+ */
+template<typename T, std::size_t N = 1024, std::size_t ArenaSize = 0, std::size_t MaxBlocks = 4096>
+class AtomicBlockedQueue
+{
+	static const std::size_t AheadBlocks = 2; // Blocks to allocate in advance of the current block
+
+	struct Block
+	{
+		std::array<T, N> entries;
+		std::array<std::atomic<bool>, N> ready = {};
+		ByteArena arena = ByteArena(ArenaSize);
+	};
+
+	struct Lifetime {};
+
+	struct Culled
+	{
+		std::shared_ptr<Lifetime> lifetime; // Referenced by all Views that may still access culled blocks
+		std::size_t endBlock;
+	};
+
+	// Ring of blocks by block number, a slot is only reused once its previous block got deleted
+	std::unique_ptr<std::atomic<Block*>[]> m_blocks;
+	std::atomic<std::size_t> m_reserved = 0; // Next index to reserve
+	std::atomic<std::size_t> m_freed = 0; // Blocks before this got deleted, and their slots may be reused
+	std::atomic<std::size_t> m_dropped = 0, m_fallbacks = 0;
+	std::atomic<uint32_t> m_allocRequests = 0;
+
+	// Reader state, protected by m_mutex
+	mutable std::mutex m_mutex;
+	mutable std::size_t m_published = 0; // All entries before are ready
+	std::size_t m_begin = 0; // First entry not culled
+	std::size_t m_culledBlocks = 0; // Blocks before this are culled, and will be deleted once unreferenced
+	std::shared_ptr<Lifetime> m_lifetime;
+	std::queue<Culled> m_culled;
+
+	// Declared last so that it is joined before anything else is destroyed
+	std::jthread m_allocator;
+
+	inline Block *getBlock(std::size_t block) const
+	{
+		return m_blocks[block%MaxBlocks].load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Get block, or allocate it if it doesn't exist yet
+	 * Block must be within capacity, so that its slot is either empty or already holds it
+	 */
+	Block *ensureBlock(std::size_t block, bool fallback)
+	{
+		auto &slot = m_blocks[block%MaxBlocks];
+		Block *existing = slot.load(std::memory_order_acquire);
+		if (existing) return existing;
+		Block *allocated = new Block();
+		if (!slot.compare_exchange_strong(existing, allocated, std::memory_order_acq_rel))
+		{ // Lost race against allocator or another producer
+			delete allocated;
+			return existing;
+		}
+		if (fallback)
+			m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+		return allocated;
+	}
+
+	void allocate(std::stop_token stop_token)
+	{
+		std::stop_callback wake(stop_token, [this]()
+		{
+			m_allocRequests.fetch_add(1, std::memory_order_release);
+			m_allocRequests.notify_one();
+		});
+		while (!stop_token.stop_requested())
+		{
+			uint32_t requests = m_allocRequests.load(std::memory_order_acquire);
+			std::size_t next = m_reserved.load(std::memory_order_relaxed)/N;
+			std::size_t limit = m_freed.load(std::memory_order_acquire) + MaxBlocks;
+			for (std::size_t b = next; b <= next+AheadBlocks && b < limit; b++)
+				ensureBlock(b, false);
+			m_allocRequests.wait(requests, std::memory_order_acquire);
+		}
+	}
+
+	/**
+	 * Advance the contiguous range of ready entries (m_mutex locked)
+	 */
+	std::size_t updatePublished() const
+	{
+		std::size_t reserved = m_reserved.load(std::memory_order_acquire);
+		while (m_published < reserved)
+		{
+			Block *block = getBlock(m_published/N);
+			if (!block || !block->ready[m_published%N].load(std::memory_order_acquire))
+				break;
+			m_published++;
+		}
+		return m_published;
+	}
+
+	/**
+	 * Cull all entries before index, with blocks being deleted once no View references them anymore (m_mutex locked)
+	 */
+	void cullTo(std::size_t index)
+	{
+		if (index <= m_begin) return;
+		m_begin = index;
+		if (index/N > m_culledBlocks)
+		{ // Exchange lifetime to allow controlled deletion of culled blocks
+			m_culledBlocks = index/N;
+			m_culled.push({ std::move(m_lifetime), m_culledBlocks });
+			m_lifetime = std::make_shared<Lifetime>();
+		}
+	}
+
+public:
+	static const std::size_t BlockSize = N;
+
+	class View;
+
+	class iterator
+	{
+		const View *view = nullptr;
+		std::size_t i = 0;
+	public:
+		using value_type = const T;
+		using difference_type = long;
+		using pointer = value_type*;
+		using reference = value_type&;
+		using iterator_category = std::forward_iterator_tag;
+
+		iterator() {}
+		iterator(const View &View, std::size_t index) : view(&View), i(index) {}
+		iterator& operator++() { i++; return *this; }
+		iterator operator++(int) { iterator retval = *this; ++(*this); return retval; }
+		long operator-(const iterator &other) const { return (long)i - (long)other.i; }
+		bool operator<(const iterator &other) const { return i < other.i; }
+		bool operator==(const iterator &other) const { return i == other.i; }
+		bool operator!=(const iterator &other) const { return i != other.i; }
+		bool valid() const { return view && i >= view->beginIndex() && i <= view->endIndex(); }
+		bool accessible() const { return view && i >= view->beginIndex() && i < view->endIndex(); }
+		reference operator*() const { assert(accessible()); return view->at(i); }
+		pointer operator->() const { assert(accessible()); return &view->at(i); }
+		std::size_t index() const { return i; }
+	};
+
+	/**
+	 * Snapshot of the ready range of the queue, keeping culled blocks alive while it exists
+	 * Indices are absolute, so beginIndex() > 0 after culling
+	 */
+	class View
+	{
+		const AtomicBlockedQueue *m_queue = nullptr;
+		std::shared_ptr<Lifetime> m_blockLock;
+		std::size_t m_begin = 0, m_end = 0;
+
+	public:
+		View() {} // Invalid view
+
+		View(const AtomicBlockedQueue &queue) : m_queue(&queue)
+		{
+			std::unique_lock lock(queue.m_mutex);
+			m_blockLock = queue.m_lifetime;
+			m_begin = queue.m_begin;
+			m_end = queue.updatePublished();
+		}
+
+		std::size_t beginIndex() const { return m_begin; }
+		std::size_t endIndex() const { return m_end; }
+		std::size_t size() const { return m_end - m_begin; }
+		bool empty() const { return m_begin == m_end; }
+
+		const T& operator[](std::size_t n) const { return at(n); }
+		const T& at(std::size_t n) const
+		{
+			assert(n >= m_begin && n < m_end);
+			return m_queue->getBlock(n/N)->entries[n%N];
+		}
+
+		/**
+		 * Memory held by the block of an entry, including its arena
+		 */
+		std::size_t blockMemory(std::size_t n) const
+		{
+			assert(n >= m_begin && n < m_end);
+			return sizeof(Block) + m_queue->getBlock(n/N)->arena.memory();
+		}
+
+		/**
+		 * Arena of the block of an entry, e.g. to store data derived from it
+		 */
+		ByteArena& arena(std::size_t n) const
+		{
+			assert(n >= m_begin && n < m_end);
+			return m_queue->getBlock(n/N)->arena;
+		}
+
+		iterator pos(std::size_t n) const { return iterator(*this, n); }
+		iterator begin() const { return iterator(*this, m_begin); }
+		iterator end() const { return iterator(*this, m_end); }
+		const T &front() const { return at(m_begin); }
+		const T &back() const { return at(m_end-1); }
+	};
+
+	AtomicBlockedQueue()
+	{
+		m_blocks = std::make_unique<std::atomic<Block*>[]>(MaxBlocks);
+		m_lifetime = std::make_shared<Lifetime>();
+		m_allocator = std::jthread([this](std::stop_token stop_token){ allocate(stop_token); });
+	}
+	AtomicBlockedQueue(const AtomicBlockedQueue&) = delete;
+	AtomicBlockedQueue &operator=(const AtomicBlockedQueue&) = delete;
+
+	~AtomicBlockedQueue()
+	{
+		m_allocator = {}; // Stop and join before deleting blocks
+		for (std::size_t b = 0; b < MaxBlocks; b++)
+			delete m_blocks[b].load();
+	}
+
+	/**
+	 * Append an entry from any thread without locking, written in place by the given function
+	 * The function receives the entry and the arena of its block to store variable-sized data in
+	 * Returns false if it was dropped because the queue is at capacity
+	 */
+	template<typename Func>
+	bool emplace_back(Func &&write)
+	{
+		std::size_t index = m_reserved.load(std::memory_order_relaxed);
+		do
+		{
+			if (index/N >= m_freed.load(std::memory_order_acquire) + MaxBlocks)
+			{ // Slot of block still occupied, wait for culling
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+		while (!m_reserved.compare_exchange_weak(index, index+1, std::memory_order_relaxed));
+
+		Block *block = ensureBlock(index/N, true);
+		write(block->entries[index%N], block->arena);
+		block->ready[index%N].store(true, std::memory_order_release);
+		if (index%N == 0)
+		{ // Started a new block, have allocator prepare the next ones
+			m_allocRequests.fetch_add(1, std::memory_order_release);
+			m_allocRequests.notify_one();
+		}
+		return true;
+	}
+
+	/**
+	 * Append an entry from any thread without locking
+	 * Returns false if it was dropped because the queue is at capacity
+	 */
+	template<typename U = T>
+	bool push_back(U&& x)
+	{
+		return emplace_back([&](T &entry, ByteArena&){ entry = std::forward<U>(x); });
+	}
+
+	View getView() const
+	{
+		return View(*this);
+	}
+
+	/**
+	 * Cull all ready entries
+	 * Existing views continue to work, new views begin after the culled entries
+	 * Blocks are only deleted by delete_culled once no view references them
+	 */
+	void cull_all()
+	{
+		std::unique_lock lock(m_mutex);
+		cullTo(updatePublished());
+	}
+
+	/**
+	 * Cull all ready entries before index, if not already culled
+	 */
+	void cull_to(std::size_t index)
+	{
+		std::unique_lock lock(m_mutex);
+		cullTo(std::min(index, updatePublished()));
+	}
+
+	/**
+	 * Cull any number of blocks of size N from the front of the queue.
+	 * Must not cull the last, currently writing block, so abs(num) < blocks
+	 * if num < 0, count from back, leave -num blocks
+	 * if num > 0, count from front, remove num blocks
+	 */
+	void cull_front(int num = -1)
+	{
+		std::unique_lock lock(m_mutex);
+		std::size_t first = m_begin/N, last = updatePublished()/N;
+		std::size_t count = last+1 - first;
+		if (count <= (std::size_t)std::abs(num))
+			return; // Not allowed to cull last block - use cull_all instead
+		cullTo((num < 0? last+1+num : first+num)*N);
+	}
+
+	/**
+	 * Returns true if culled blocks exist that have not yet been deleted.
+	 */
+	bool has_culled() const
+	{
+		std::unique_lock lock(m_mutex);
+		return !m_culled.empty();
+	}
+
+	/**
+	 * Delete any culled blocks not referenced by a View anymore, freeing their slots for new blocks
+	 */
+	void delete_culled()
+	{
+		std::vector<Block*> removedBlocks;
+		{
+			std::unique_lock lock(m_mutex);
+			while (!m_culled.empty() && m_culled.front().lifetime.use_count() == 1)
+			{
+				std::size_t freed = m_freed.load(std::memory_order_relaxed);
+				for (std::size_t b = freed; b < m_culled.front().endBlock; b++)
+					removedBlocks.push_back(m_blocks[b%MaxBlocks].exchange(nullptr, std::memory_order_acq_rel));
+				m_freed.store(m_culled.front().endBlock, std::memory_order_release);
+				m_culled.pop();
+			}
+		}
+		// Deleting may take a while, do it without holding the mutex
+		for (Block *block : removedBlocks)
+			delete block;
+	}
+
+	/**
+	 * Number of entries dropped because the queue was at capacity
+	 */
+	std::size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * Number of blocks producers had to allocate themselves because the allocator fell behind
+	 */
+	std::size_t fallbackAllocations() const { return m_fallbacks.load(std::memory_order_relaxed); }
+};
+
+#endif // ATOMIC_BLOCKED_QUEUE_H
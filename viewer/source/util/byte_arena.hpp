@@ -0,0 +1,135 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef BYTE_ARENA_H
+#define BYTE_ARENA_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+
+/**
+ * Fixed-size append-only byte arena, allocated from by any number of threads without locking
+ * Memory is only ever freed as a whole when the arena is destroyed
+ * Once full, allocations fall back to separate chunks that are freed alongside the arena
+ */
+class ByteArena
+{
+	struct Overflow
+	{
+		Overflow *next;
+	};
+
+	std::unique_ptr<char[]> m_data;
+	std::size_t m_capacity;
+	std::atomic<std::size_t> m_used = 0, m_overflowBytes = 0;
+	std::atomic<Overflow*> m_overflow = nullptr;
+
+public:
+	ByteArena(std::size_t capacity) : m_data(capacity? new char[capacity] : nullptr), m_capacity(capacity) {}
+	ByteArena(const ByteArena&) = delete;
+	ByteArena &operator=(const ByteArena&) = delete;
+
+	~ByteArena()
+	{
+		Overflow *chunk = m_overflow.load();
+		while (chunk)
+		{
+			Overflow *next = chunk->next;
+			::operator delete(chunk);
+			chunk = next;
+		}
+	}
+
+	/**
+	 * Allocate bytes that stay valid for the lifetime of the arena (any thread)
+	 */
+	char *allocate(std::size_t size)
+	{
+		if (m_used.load(std::memory_order_relaxed) + size <= m_capacity)
+		{ // Only bump while there is space, so a full arena stays full
+			std::size_t offset = m_used.fetch_add(size, std::memory_order_relaxed);
+			if (offset + size <= m_capacity)
+				return m_data.get() + offset;
+		}
+		Overflow *chunk = (Overflow*)::operator new(sizeof(Overflow) + size);
+		chunk->next = m_overflow.load(std::memory_order_relaxed);
+		while (!m_overflow.compare_exchange_weak(chunk->next, chunk, std::memory_order_release, std::memory_order_relaxed));
+		m_overflowBytes.fetch_add(sizeof(Overflow) + size, std::memory_order_relaxed);
+		return (char*)(chunk+1);
+	}
+
+	std::size_t capacity() const { return m_capacity; }
+
+	/**
+	 * Memory held by the arena, including overflow chunks
+	 */
+	std::size_t memory() const
+	{
+		return m_capacity + m_overflowBytes.load(std::memory_order_relaxed);
+	}
+};
+
+/**
+ * Reference to bytes stored inline if short enough, else in a ByteArena
+ * Trivially destructible, so that arrays of it can be freed wholesale together with the arena
+ */
+struct ArenaBytes
+{
+	static const int InlineCapacity = 16;
+	union
+	{
+		char inlined[InlineCapacity];
+		const char *external;
+	};
+	uint32_t length = 0;
+
+	inline const char *data() const { return length <= InlineCapacity? inlined : external; }
+	inline std::string_view view() const { return std::string_view(data(), length); }
+
+	/**
+	 * Copy bytes inline or into the arena
+	 */
+	inline void store(ByteArena &arena, const void *bytes, std::size_t size)
+	{
+		if (size <= InlineCapacity)
+		{
+			if (size > 0)
+				std::memcpy(inlined, bytes, size);
+		}
+		else
+		{
+			char *allocated = arena.allocate(size);
+			std::memcpy(allocated, bytes, size);
+			external = allocated;
+		}
+		length = size;
+	}
+};
+
+#endif // BYTE_ARENA_H
@@ -0,0 +1,201 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Minimal gzip compressor for text-like data without external dependencies
+ * Single DEFLATE block with the fixed Huffman codes and LZ77 matching over a hash chain of limited depth
+ * Compresses worse than zlib (no dynamic codes, no lazy matching), but well enough for e.g. rotated log files
+ */
+
+namespace gzip_impl
+{
+	static const int WindowSize = 1<<15, HashSize = 1<<15, MaxChain = 16;
+	static const int MinMatch = 3, MaxMatch = 258;
+
+	static const uint16_t LengthBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+	static const uint8_t LengthExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+	static const uint16_t DistanceBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+	static const uint8_t DistanceExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+	struct BitWriter
+	{
+		std::vector<uint8_t> &out;
+		uint32_t bits = 0;
+		int count = 0;
+
+		// Values are packed starting from the least significant bit
+		inline void write(uint32_t value, int n)
+		{
+			bits |= value << count;
+			count += n;
+			while (count >= 8)
+			{
+				out.push_back(bits & 0xFF);
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+
+		// Huffman codes are packed starting from the most significant bit
+		inline void writeCode(uint32_t code, int n)
+		{
+			uint32_t reversed = 0;
+			for (int i = 0; i < n; i++)
+				reversed |= ((code >> i) & 1) << (n-1-i);
+			write(reversed, n);
+		}
+
+		inline void flush()
+		{
+			if (count > 0)
+				out.push_back(bits & 0xFF);
+			bits = 0;
+			count = 0;
+		}
+	};
+
+	inline void writeSymbol(BitWriter &writer, int symbol)
+	{ // Fixed literal/length code
+		if (symbol < 144) writer.writeCode(0x30 + symbol, 8);
+		else if (symbol < 256) writer.writeCode(0x190 + symbol - 144, 9);
+		else if (symbol < 280) writer.writeCode(symbol - 256, 7);
+		else writer.writeCode(0xC0 + symbol - 280, 8);
+	}
+
+	inline void writeMatch(BitWriter &writer, int length, int distance)
+	{
+		int l = 28;
+		while (LengthBase[l] > length) l--;
+		writeSymbol(writer, 257 + l);
+		writer.write(length - LengthBase[l], LengthExtra[l]);
+		int d = 29;
+		while (DistanceBase[d] > distance) d--;
+		writer.writeCode(d, 5);
+		writer.write(distance - DistanceBase[d], DistanceExtra[d]);
+	}
+
+	inline uint32_t crc32(const uint8_t *data, std::size_t size)
+	{
+		static const auto table = []()
+		{
+			std::vector<uint32_t> table(256);
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = c & 1? 0xEDB88320 ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+			return table;
+		}();
+		uint32_t crc = 0xFFFFFFFF;
+		for (std::size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFF;
+	}
+
+	inline uint32_t hash(const uint8_t *data)
+	{
+		return ((data[0] << 16 | data[1] << 8 | data[2]) * 2654435761u) >> (32-15);
+	}
+}
+
+/**
+ * Compress data into a complete gzip stream
+ */
+inline std::vector<uint8_t> GzipCompress(const uint8_t *data, std::size_t size)
+{
+	using namespace gzip_impl;
+	std::vector<uint8_t> out;
+	out.reserve(size/2 + 64);
+	const uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF }; // Deflate, no flags, no time, unknown OS
+	out.insert(out.end(), header, header+10);
+
+	BitWriter writer = { out };
+	writer.write(1, 1); // Final block
+	writer.write(1, 2); // Fixed Huffman codes
+
+	std::vector<int64_t> head(HashSize, -1), prev(WindowSize, -1);
+	auto insert = [&](std::size_t pos)
+	{
+		uint32_t h = hash(data+pos);
+		prev[pos & (WindowSize-1)] = head[h];
+		head[h] = pos;
+	};
+	std::size_t pos = 0;
+	while (pos < size)
+	{
+		int bestLength = 0, bestDistance = 0;
+		if (pos + MinMatch <= size)
+		{
+			int maxLength = (int)std::min<std::size_t>(MaxMatch, size - pos);
+			int64_t candidate = head[hash(data+pos)];
+			for (int chain = 0; chain < MaxChain && candidate >= 0 && (int64_t)pos - candidate <= WindowSize; chain++)
+			{
+				int length = 0;
+				while (length < maxLength && data[candidate+length] == data[pos+length])
+					length++;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = (int)(pos - candidate);
+					if (length == maxLength) break;
+				}
+				int64_t next = prev[candidate & (WindowSize-1)];
+				if (next >= candidate) break; // Overwritten by a newer position
+				candidate = next;
+			}
+			insert(pos);
+		}
+		if (bestLength >= MinMatch)
+		{
+			writeMatch(writer, bestLength, bestDistance);
+			for (std::size_t i = pos+1; i < pos+bestLength && i + MinMatch <= size; i++)
+				insert(i);
+			pos += bestLength;
+		}
+		else
+		{
+			writeSymbol(writer, data[pos]);
+			pos++;
+		}
+	}
+	writeSymbol(writer, 256); // End of block
+	writer.flush();
+
+	uint32_t crc = crc32(data, size), isize = (uint32_t)size;
+	for (int i = 0; i < 4; i++) out.push_back((crc >> (i*8)) & 0xFF);
+	for (int i = 0; i < 4; i++) out.push_back((isize >> (i*8)) & 0xFF);
+	return out;
+}
+
+#endif // GZIP_H
@@ -34,6 +34,8 @@ SOFTWARE.
 #ifndef LOG_H
 #define LOG_H
 
+#include "util/log_args.hpp"
+
 #include <cstdint>
 
 enum LogCategory {
@@ -64,14 +66,38 @@ enum LogLevel : char {
 
 int PrintLog(LogCategory c, LogLevel l, int ctx, _Printf_format_string_ const char *f, ...);
 int PrintLogCont(LogCategory c, LogLevel l, int ctx, _Printf_format_string_ const char *f, ...);
+static inline void CheckLogFormat(_Printf_format_string_ const char *f, ...) {}
 
 #else
 
 int PrintLog(LogCategory c, LogLevel l, int ctx, const char *f, ...) __attribute__ ((format (printf,4,5)));
 int PrintLogCont(LogCategory c, LogLevel l, int ctx, const char *f, ...) __attribute__ ((format (printf,4,5)));
+static inline void CheckLogFormat(const char *f, ...) __attribute__ ((format (printf,1,2)));
+static inline void CheckLogFormat(const char *f, ...) {}
 
 #endif
 
+/**
+ * Log with arguments already packed, formatting is deferred until the message is read
+ * Format needs to be a static string
+ */
+int PrintLogDeferred(LogCategory c, LogLevel l, int ctx, const char *f, const LogArgs &args);
+
+/**
+ * Pack arguments and log them for deferred formatting, or format immediately if they don't fit
+ */
+template<typename... Args>
+static inline int DeferLog(LogCategory c, LogLevel l, int ctx, const char *f, const Args&... args)
+{
+	LogArgs packed;
+	if constexpr (sizeof...(Args) > 0)
+	{
+		if (!packed.write(args...))
+			return PrintLog(c, l, ctx, f, args...);
+	}
+	return PrintLogDeferred(c, l, ctx, f, packed);
+}
+
 
 extern LogLevel LogMaxLevelTable[LMaxCategory];
 extern LogLevel LogFilterTable[LMaxCategory];
@@ -93,29 +119,35 @@ extern uint32_t LogLevelHexColors[LMaxLevel];
 #define SHOULD_LOGC(LEVEL) SHOULD_LOG(CurrentLogCategory, LEVEL)
 #define SHOULD_LOGCL() SHOULD_LOG(CurrentLogCategory, CurrentLogLevel)
 
+// Logs are deferred, so format has to be a string literal ("" enforces that) and is checked at compile time separately
 #define LOG(CATEGORY, LEVEL, ...) { \
 	if (SHOULD_LOG(CATEGORY, LEVEL)) \
-		PrintLog(CATEGORY, LEVEL, CurrentLogContext, __VA_ARGS__); \
+		DeferLog(CATEGORY, LEVEL, CurrentLogContext, "" __VA_ARGS__); \
+	if (false) CheckLogFormat(__VA_ARGS__); \
 }
 
 #define LOGC(LEVEL, ...) { \
 	if (SHOULD_LOG(CurrentLogCategory, LEVEL)) \
-		PrintLog(CurrentLogCategory, LEVEL, CurrentLogContext, __VA_ARGS__); \
+		DeferLog(CurrentLogCategory, LEVEL, CurrentLogContext, "" __VA_ARGS__); \
+	if (false) CheckLogFormat(__VA_ARGS__); \
 }
 
 #define LOGL(CATEGORY, ...) { \
 	if (SHOULD_LOG(CATEGORY, CurrentLogLevel)) \
-		PrintLog(CATEGORY, CurrentLogLevel, CurrentLogContext, __VA_ARGS__); \
+		DeferLog(CATEGORY, CurrentLogLevel, CurrentLogContext, "" __VA_ARGS__); \
+	if (false) CheckLogFormat(__VA_ARGS__); \
 }
 
 #define LOGCL(...) { \
 	if (SHOULD_LOG(CurrentLogCategory, CurrentLogLevel)) \
-		PrintLog(CurrentLogCategory, CurrentLogLevel, CurrentLogContext, __VA_ARGS__); \
+		DeferLog(CurrentLogCategory, CurrentLogLevel, CurrentLogContext, "" __VA_ARGS__); \
+	if (false) CheckLogFormat(__VA_ARGS__); \
 }
 
 #define LOGCONTC(LEVEL, ...) { \
 	if (SHOULD_LOG(CurrentLogCategory, LEVEL)) \
-		PrintLog(CurrentLogCategory, LEVEL, CurrentLogContext, __VA_ARGS__); \
+		DeferLog(CurrentLogCategory, LEVEL, CurrentLogContext, "" __VA_ARGS__); \
+	if (false) CheckLogFormat(__VA_ARGS__); \
 }
 
 #define LOGCONT(CATEGORY, LEVEL, ...) { \
@@ -0,0 +1,134 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef LOG_ARGS_H
+#define LOG_ARGS_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+enum class LogArgType : uint8_t
+{ // Types after default argument promotion, as printf expects them
+	Int, UInt, Long, ULong, LongLong, ULongLong,
+	Double, Pointer, String, NullString
+};
+
+/**
+ * Compact binary copy of the arguments of a printf-style log call, to defer formatting until the message is read
+ * Each argument is stored as a type tag followed by its value, strings are copied including their terminator
+ * Formatting applies each conversion of the format string to its argument individually, so the format string
+ * needs to outlive the arguments (e.g. a string literal), and the argument types need to match the format
+ */
+struct LogArgs
+{
+	static const int Capacity = 512;
+	uint16_t size = 0;
+	uint8_t data[Capacity];
+
+	/**
+	 * Append arguments, returns false if they exceed the capacity
+	 */
+	template<typename... Args>
+	bool write(const Args&... args)
+	{
+		return (writeArg(args) && ...);
+	}
+
+	/**
+	 * Format message into text, returns false if the arguments don't match the format string
+	 */
+	bool format(const char *format, std::string &text) const
+	{
+		return LogArgs::format(format, data, size, text);
+	}
+
+	/**
+	 * Format message from arguments packed by LogArgs and stored elsewhere
+	 */
+	static bool format(const char *format, const uint8_t *data, std::size_t size, std::string &text);
+
+private:
+	inline bool writeValue(LogArgType type, const void *value, std::size_t length)
+	{
+		if (size + 1 + length > Capacity)
+			return false;
+		data[size] = (uint8_t)type;
+		if (length > 0)
+			std::memcpy(data+size+1, value, length);
+		size += 1 + length;
+		return true;
+	}
+
+	template<typename V>
+	inline bool writeValue(LogArgType type, V value)
+	{
+		return writeValue(type, &value, sizeof(V));
+	}
+
+	inline bool writeString(const char *str)
+	{
+		if (!str)
+			return writeValue(LogArgType::NullString, nullptr, 0);
+		return writeValue(LogArgType::String, str, std::strlen(str)+1);
+	}
+
+	template<typename I>
+	inline bool writeInteger(I value)
+	{
+		using P = decltype(+value); // Default argument promotion
+		if constexpr (std::is_same_v<P, int>) return writeValue(LogArgType::Int, (P)value);
+		else if constexpr (std::is_same_v<P, unsigned int>) return writeValue(LogArgType::UInt, (P)value);
+		else if constexpr (std::is_same_v<P, long>) return writeValue(LogArgType::Long, (P)value);
+		else if constexpr (std::is_same_v<P, unsigned long>) return writeValue(LogArgType::ULong, (P)value);
+		else if constexpr (std::is_same_v<P, long long>) return writeValue(LogArgType::LongLong, (P)value);
+		else if constexpr (std::is_same_v<P, unsigned long long>) return writeValue(LogArgType::ULongLong, (P)value);
+		else static_assert(sizeof(I) == 0, "Unsupported integer log argument!");
+	}
+
+	template<typename A>
+	inline bool writeArg(const A &arg)
+	{
+		using D = std::decay_t<A>;
+		if constexpr (std::is_pointer_v<D> && std::is_same_v<std::remove_cv_t<std::remove_pointer_t<D>>, char>)
+			return writeString(arg);
+		else if constexpr (std::is_pointer_v<D> || std::is_null_pointer_v<D>)
+			return writeValue(LogArgType::Pointer, (const void*)arg);
+		else if constexpr (std::is_floating_point_v<D>)
+		{
+			static_assert(!std::is_same_v<D, long double>, "Unsupported long double log argument!");
+			return writeValue(LogArgType::Double, (double)arg);
+		}
+		else if constexpr (std::is_enum_v<D>)
+			return writeInteger((std::underlying_type_t<D>)arg);
+		else if constexpr (std::is_integral_v<D>)
+			return writeInteger(arg);
+		else
+			static_assert(sizeof(D) == 0, "Unsupported log argument!");
+	}
+};
+
+#endif // LOG_ARGS_H
@@ -0,0 +1,106 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Sequence lock protecting a small value written by a single thread and read by any number of threads
+ * Neither writer nor readers ever block or lock, readers only retry a copy if it overlapped with a write
+ * Suited for frequently updated state like poses, where readers only ever care about the most recent value
+ * 
+ * The sequence is odd while a write is in progress, so sequence()/2 is the number of completed writes
+ * NOTE: Only one thread may write at a time, use external synchronisation if the writing thread changes
+ */
+template<typename T>
+class SeqLock
+{
+	std::atomic<uint32_t> m_sequence = 0;
+	T m_value = {};
+
+public:
+	SeqLock() {}
+	SeqLock(const T &value) : m_value(value) {}
+
+	/**
+	 * Publish a new value (writer thread only)
+	 */
+	void write(const T &value)
+	{
+		update([&](T &data){ data = value; });
+	}
+
+	/**
+	 * Modify the value in-place and publish it (writer thread only)
+	 */
+	template<typename Func>
+	void update(Func &&modify)
+	{
+		uint32_t seq = m_sequence.load(std::memory_order_relaxed);
+		m_sequence.store(seq+1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		modify(m_value);
+		m_sequence.store(seq+2, std::memory_order_release);
+	}
+
+	/**
+	 * Access the value without synchronisation (writer thread only)
+	 */
+	const T &peek() const
+	{
+		return m_value;
+	}
+
+	/**
+	 * Read a consistent copy of the value (any thread)
+	 */
+	T read() const
+	{
+		T value;
+		uint32_t seq0, seq1;
+		do
+		{
+			seq0 = m_sequence.load(std::memory_order_acquire);
+			value = m_value;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			seq1 = m_sequence.load(std::memory_order_relaxed);
+		}
+		while ((seq0 & 1) || seq0 != seq1);
+		return value;
+	}
+
+	/**
+	 * Sequence number to cheaply check for new values without reading them
+	 */
+	uint32_t sequence() const
+	{
+		return m_sequence.load(std::memory_order_acquire);
+	}
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,245 @@
+/**
+AsterTrack Optical Tracking System
+Copyright (C)  2025 Seneral <contact@seneral.dev> and contributors
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <functional> // std::hash
+
+/**
+ * Stable handle to an element of a SlotMap
+ * The generation invalidates handles of erased elements, even if their slot gets reused
+ */
+struct SlotHandle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	inline bool valid() const { return index != UINT32_MAX; }
+	inline uint64_t key() const { return ((uint64_t)generation << 32) | index; }
+	bool operator==(const SlotHandle &other) const = default;
+};
+
+template<>
+struct std::hash<SlotHandle>
+{
+	std::size_t operator()(const SlotHandle &handle) const noexcept
+	{
+		return std::hash<uint64_t>()(handle.key());
+	}
+};
+
+/**
+ * Generational slot map with stable handles and constant-time lookup, insertion and removal of elements
+ * Elements are stored in place in blocks of N slots that are never moved, so pointers to elements stay valid until
+ * they are erased, and elements need not be movable (e.g. containing atomics or locks)
+ * Iteration follows insertion order through a list linked in the slots themselves, so removal keeps that order
+ */
+template<typename T, std::size_t N = 64>
+class SlotMap
+{
+private:
+	static const uint32_t None = UINT32_MAX;
+
+	struct Slot
+	{
+		alignas(T) unsigned char storage[sizeof(T)];
+		uint32_t generation = 0;
+		uint32_t prev = None, next = None; // Neighbours in insertion order while alive
+		bool alive = false;
+
+		inline T *get() { return std::launder(reinterpret_cast<T*>(storage)); }
+		inline const T *get() const { return std::launder(reinterpret_cast<const T*>(storage)); }
+	};
+	typedef std::array<Slot, N> Block;
+
+	std::vector<std::unique_ptr<Block>> m_blocks;
+	std::vector<uint32_t> m_free; // Slots to reuse
+	uint32_t m_first = None, m_last = None; // Live slots in insertion order
+	std::size_t m_size = 0;
+
+	inline Slot &slot(uint32_t index) { return (*m_blocks[index/N])[index%N]; }
+	inline const Slot &slot(uint32_t index) const { return (*m_blocks[index/N])[index%N]; }
+
+	template<bool Const>
+	class Iterator
+	{
+		typedef std::conditional_t<Const, const SlotMap, SlotMap> Map;
+		Map *map;
+		uint32_t index;
+		friend SlotMap;
+
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef std::ptrdiff_t difference_type;
+		typedef std::conditional_t<Const, const T, T> value_type;
+		typedef value_type *pointer;
+		typedef value_type &reference;
+
+		Iterator(Map *Map, uint32_t Index) : map(Map), index(Index) {}
+		reference operator*() const { return *map->slot(index).get(); }
+		pointer operator->() const { return map->slot(index).get(); }
+		Iterator &operator++() { index = map->slot(index).next; return *this; }
+		Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+		bool operator==(const Iterator &other) const { return index == other.index; }
+		bool operator!=(const Iterator &other) const { return index != other.index; }
+
+		SlotHandle handle() const
+		{
+			return { index, map->slot(index).generation };
+		}
+	};
+
+public:
+	typedef Iterator<false> iterator;
+	typedef Iterator<true> const_iterator;
+
+	SlotMap() {}
+	SlotMap(const SlotMap&) = delete;
+	SlotMap &operator=(const SlotMap&) = delete;
+	~SlotMap() { clear(); }
+
+	/**
+	 * Construct a new element in place and return its handle
+	 */
+	template<typename... Args>
+	SlotHandle emplace(Args&&... args)
+	{
+		uint32_t index;
+		if (!m_free.empty())
+		{
+			index = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			index = m_blocks.size()*N;
+			m_blocks.push_back(std::make_unique<Block>());
+			// Reuse lowest slots first
+			for (uint32_t i = index+N-1; i > index; i--)
+				m_free.push_back(i);
+		}
+		Slot &s = slot(index);
+		new (s.storage) T(std::forward<Args>(args)...);
+		s.alive = true;
+		// Append to insertion order
+		s.prev = m_last;
+		s.next = None;
+		if (m_last != None) slot(m_last).next = index;
+		else m_first = index;
+		m_last = index;
+		m_size++;
+		return { index, s.generation };
+	}
+
+	/**
+	 * Resolve a handle, returns nullptr if it is invalid or the element has been erased
+	 */
+	T *get(SlotHandle handle)
+	{
+		if (handle.index >= m_blocks.size()*N) return nullptr;
+		Slot &s = slot(handle.index);
+		if (!s.alive || s.generation != handle.generation) return nullptr;
+		return s.get();
+	}
+	const T *get(SlotHandle handle) const
+	{
+		return const_cast<SlotMap*>(this)->get(handle);
+	}
+
+	bool contains(SlotHandle handle) const { return get(handle) != nullptr; }
+
+	/**
+	 * Erase element, invalidating its handle and pointers to it
+	 */
+	bool erase(SlotHandle handle)
+	{
+		if (!get(handle)) return false;
+		erase(iterator(this, handle.index));
+		return true;
+	}
+
+	/**
+	 * Erase element at iterator, returning the iterator to the next element
+	 */
+	iterator erase(iterator it)
+	{
+		uint32_t index = it.index;
+		Slot &s = slot(index);
+		assert(s.alive);
+		uint32_t next = s.next;
+		// Unlink from insertion order
+		if (s.prev != None) slot(s.prev).next = s.next;
+		else m_first = s.next;
+		if (s.next != None) slot(s.next).prev = s.prev;
+		else m_last = s.prev;
+		s.get()->~T();
+		s.alive = false;
+		s.generation++;
+		s.prev = s.next = None;
+		m_free.push_back(index);
+		m_size--;
+		return iterator(this, next);
+	}
+
+	template<typename Pred>
+	std::size_t remove_if(Pred &&pred)
+	{
+		std::size_t removed = 0;
+		for (auto it = begin(); it != end();)
+		{
+			if (pred(*it))
+			{
+				it = erase(it);
+				removed++;
+			}
+			else it++;
+		}
+		return removed;
+	}
+
+	void clear()
+	{
+		while (m_last != None)
+			erase(iterator(this, m_last));
+	}
+
+	std::size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	iterator begin() { return iterator(this, m_first); }
+	iterator end() { return iterator(this, None); }
+	const_iterator begin() const { return const_iterator(this, m_first); }
+	const_iterator end() const { return const_iterator(this, None); }
+};
+
+#endif // SLOT_MAP_H